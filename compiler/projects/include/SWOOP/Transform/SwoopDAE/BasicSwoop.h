@@ -28,6 +28,7 @@
 #include <string>
 
 #include "Util/Analysis/LoopCarriedDependencyAnalysis.h"
+#include "Util/Annotation/LoopHints.h"
 #include "Util/Annotation/MetadataInfo.h"
 #include "Util/DAE/DAEUtils.h"
 #include "Util/Analysis/LoopDependency.h"
@@ -75,6 +76,17 @@ namespace swoop {
     // Main functionality: swoopifying function F
     bool swoopify(Function &F);
 
+    // Turns kernel F into a dispatcher that checks at runtime whether the
+    // may-aliasing loads and stores of its loop overlap, and calls Overlap if
+    // they do, Disjoint otherwise. Both are clones of F, still to be
+    // swoopified. Returns false (and leaves F unchanged) if the may-aliasing
+    // pairs cannot all be covered by the checks.
+    bool versionOnRuntimeChecks(Function &F, Function *&Overlap, Function *&Disjoint);
+
+    // Replaces the loads of F with a constant dependence distance by values
+    // rotated through registers (see ScalarReplacement.h)
+    void scalarReplace(Function &F);
+
   protected:
     LoopInfo *LI;
 
@@ -87,10 +99,19 @@ namespace swoop {
     // Postdom Tree
     PostDominatorTree *PDT;
 
+    // Unroll count and max number of indirections of the kernel in focus:
+    // -unroll and -indir-thresh, unless its loop has clairvoyance hints
+    unsigned KernelUnroll = 1;
+    unsigned KernelIndir = 0;
+
+    // Sets KernelUnroll and KernelIndir for kernel F. Returns false if the
+    // loop of F is tuned for another swoop type than -swoop-type.
+    bool readKernelHints(Function &F);
+
     ////////
     // Heuristic: is it worth transforming?
     ////////
-    bool isWorthTransforming(Function &F, list<LoadInst*> &Loads);
+    bool isWorthTransforming(Function &F, list<LoadInst*> &Loads, unsigned Intrinsics);
 
     // Divide loads into each category: prefetch, reuse or load
     virtual void divideLoads(list<LoadInst *> &toHoist,
@@ -108,6 +129,11 @@ namespace swoop {
     // Determines which instructions to reuse in the execute phase
     virtual void selectInstructionsToReuseInExecute(Function *F, set<Instruction*> *toKeep, set<Instruction*> *toUpdateForNextPhases, LCDResult MinLCDRequirement, bool ReuseAll, bool ReuseBranchCondition);
 
+    // Transforms kernel F without access phase if its loop is a kind the
+    // access phase cannot get ahead of, e.g. a linked structure traversal.
+    // Loads are the access instructions of F. Returns true if it did.
+    virtual bool swoopifyTraversal(Function &F, list<LoadInst *> &Loads);
+
     ////////
     // Filtering on Loop-carried dependencies
     ////////
@@ -144,6 +170,9 @@ namespace swoop {
 			 bool printRes = false, bool onlyPrintOnSuccess = false);
     int insertReuse(list<LoadInst *> &toReuse, set<Instruction *> &toKeep);
 
+    // Inserts prefetches for the intrinsics of F tagged in swoopify
+    int insertIntrinsicPrefetches(Function &F, set<Instruction *> &toKeep);
+
     // Removes all instructions marked as a reuse helper. See insertReuse.
     void removeReuseHelper(Function &F);  
 
@@ -33,6 +33,11 @@ namespace util {
   // Checks if two pointers alias
   AliasResult pointerAlias(AliasAnalysis *AA, Value *P1, Value *P2, const DataLayout &DL);
 
+  // Checks if the memory accessed by two instructions alias. Unlike
+  // pointerAlias, this takes the access sizes and the TBAA, scope and
+  // noalias metadata of the instructions into account.
+  AliasResult instructionAlias(AliasAnalysis *AA, Instruction *I1, Instruction *I2);
+
   // Returns the closest alias between store and any of the LoadInsts
   // in toPref.
   AliasResult crossCheck(AliasAnalysis *AA, StoreInst *store, list<LoadInst *> &toPref);
@@ -0,0 +1,93 @@
+//===-------- IndirectionDepth.h - Depth of dependent load chains ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file IndirectionDepth.h
+///
+/// \brief Load dependency DAG of a loop iteration
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Builds the dependency DAG of a set of loads within a loop iteration: a
+//  load depends on every load of the set among its requirements (see
+//  LoopDependency.h). Each load is given
+//  1) its depth: the number of loads on the longest chain of dependent loads
+//     leading to it, 0 if its requirements contain no load of the set
+//  2) its critical path latency: the estimated latency of that chain,
+//     including the load itself. Loads marked as long latency count as
+//     -indir-long-latency cycles, all others as -indir-short-latency.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef UTIL_ANALYSIS_INDIRECTIONDEPTH_H
+#define UTIL_ANALYSIS_INDIRECTIONDEPTH_H
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Instructions.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace std;
+using namespace llvm;
+
+namespace util {
+
+  class IndirectionDepth {
+  public:
+    IndirectionDepth(AliasAnalysis *AliasA, LoopInfo *LoopI)
+        : AA(AliasA), LI(LoopI), MaxDepth(0) {}
+
+    // Builds the DAG of Loads. Only dependencies between loads in Loads are
+    // edges of the DAG.
+    void analyze(const set<LoadInst *> &Loads);
+    void analyze(const list<LoadInst *> &Loads);
+
+    // Builds the DAG of all loads of F that are inside a loop
+    void analyze(Function &F);
+
+    // Depth of L, 0 for loads that were not analyzed
+    unsigned getDepth(LoadInst *L) const;
+
+    // Critical path latency of L, 0 for loads that were not analyzed
+    unsigned getLatency(LoadInst *L) const;
+
+    unsigned getMaxDepth() const { return MaxDepth; }
+
+    // Groups the loads by depth: Levels[d] contains the loads of depth d.
+    // No load depends on a load of the same or a later level.
+    void getLevels(vector<set<LoadInst *>> &Levels) const;
+
+    // Attaches the depth and critical path latency to each load as
+    // "IndirDepth" and "IndirLatency" metadata
+    void annotate() const;
+
+  private:
+    AliasAnalysis *AA;
+    LoopInfo *LI;
+
+    struct Node {
+      // Loads of the DAG that this load depends on
+      set<LoadInst *> Preds;
+      unsigned Depth;
+      unsigned Latency;
+      bool Visited;
+    };
+
+    map<LoadInst *, Node> Nodes;
+    unsigned MaxDepth;
+
+    void build();
+    void visit(LoadInst *L, Node &N);
+  };
+}
+
+#endif
@@ -0,0 +1,83 @@
+//===- LAALCDAnalysis.h - LCD Analysis based on LoopAccessAnalysis -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file LAALCDAnalysis.h
+///
+/// \brief LCD Analysis based on LoopAccessAnalysis and SCEV
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+// Loop carried dependency analysis built on LLVM's LoopAccessAnalysis. Unlike
+// the DependenceAnalysis based BasicLCDAnalysis it does not give up on pairs
+// of accesses to different underlying objects: those are either proven
+// independent or reported as requiring runtime memory checks. Distances are
+// computed from the SCEV of the accessed addresses.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef UTIL_ANALYSIS_LAALCDANALYSIS_H
+#define UTIL_ANALYSIS_LAALCDANALYSIS_H
+
+#include "Util/Analysis/LoopCarriedDependencyAnalysis.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopAccessAnalysis.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include <map>
+
+using namespace llvm;
+
+namespace util {
+
+// Returns true if the pointers A and B are in different groups of one of the
+// runtime checks in PtrChecking, i.e. they cannot overlap if the checks pass.
+bool isCheckedAtRuntime(const RuntimePointerChecking *PtrChecking, Value *A,
+                        Value *B);
+
+class LAALCDAnalysis : public LoopCarriedDependencyAnalysis {
+public:
+  LAALCDAnalysis(LoopAccessAnalysis *LoopAA, ScalarEvolution *ScalarE,
+                 AliasAnalysis *AliasA, LoopInfo *LoopI)
+      : LAA(LoopAA), SE(ScalarE), AA(AliasA), LI(LoopI) {}
+
+  ~LAALCDAnalysis();
+
+  const LCDResult checkLCD(Instruction *I, const Loop *L);
+  bool getLCDDistance(Instruction *I, const Loop *L, long int &Distance);
+  bool requiresMemoryChecks(const Loop *L, unsigned &NumChecks);
+  void setup(Function &F);
+
+private:
+  LoopAccessAnalysis *LAA;
+  ScalarEvolution *SE;
+  AliasAnalysis *AA;
+  LoopInfo *LI;
+
+  // Result for one memory instruction: the LCD class, and the smallest
+  // distance of its dependencies, including those within one iteration (valid
+  // only if HasDistance).
+  struct LCDEntry {
+    LCDResult LCD;
+    bool HasDistance;
+    long int Distance;
+    bool NeedsMemChecks;
+  };
+
+  typedef std::pair<const Loop *, Instruction *> DependenceKey;
+  std::map<DependenceKey, LCDEntry> LCDCache;
+
+  typedef SmallVector<Instruction *, 16> InstVectorTy;
+  std::map<const Loop *, InstVectorTy *> LoopToMemInst;
+
+  const LCDEntry &getEntry(Instruction *I, const Loop *L);
+  LCDEntry analyze(Instruction *I, const Loop *L);
+  const LoopAccessInfo &getAccessInfo(const Loop *L);
+};
+}
+
+#endif
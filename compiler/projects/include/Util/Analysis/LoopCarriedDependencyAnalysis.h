@@ -80,10 +80,24 @@ public:
   }
   
   virtual const LCDResult checkLCD(Instruction *I, const Loop *L) = 0;
+
+  // Sets Distance to the smallest number of iterations D >= 0 such that a
+  // store in iteration k writes a location that a load reads in iteration
+  // k + D, for the dependencies of I in L (LONG_MAX if there are none).
+  // D = 0 is a dependency within one iteration. Returns false if the
+  // distance of some dependency is unknown.
   virtual bool getLCDDistance(Instruction *I, const Loop *L,
                               long int &Distance) = 0;
   virtual void setup(Function &F) = 0;
 
+  // Returns true if the dependencies between the accesses of L can only be
+  // ruled out with runtime checks on the accessed address ranges. NumChecks
+  // is set to the number of checks required.
+  virtual bool requiresMemoryChecks(const Loop *L, unsigned &NumChecks) {
+    NumChecks = 0;
+    return false;
+  }
+
 protected:
   bool collectMemInst(const Loop &L, SmallVectorImpl<Instruction *> &MemInst) {
       for (Loop::block_iterator BB = L.block_begin(), BE = L.block_end(); BB != BE;
@@ -62,7 +62,9 @@ namespace util {
   // Dependencies are considered to be the operators of an Instruction
   // with the exceptions of calls. In case a LoadInst is a dependency
   // the coresponding StoreInst is also considered as a dependency
-  // as long it does not operate on visible memory.
+  // as long it does not operate on visible memory. Calls are allowed if
+  // they only read memory or are copyable according to the mod/ref
+  // summaries (see ModRefSummary.h).
   // Retrurns false iff a prohibited instruction are required.
   // The contents of Set and DepSet are only reliable if the result
   // is true.
@@ -0,0 +1,84 @@
+//===-------- ModRefSummary.h - Per function mod/ref summaries ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file ModRefSummary.h
+///
+/// \brief Interprocedural summaries of the memory a function may write
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Summarizes, for every function of a module, which memory it may write and
+//  whether a call to it is safe to duplicate into an access phase. Functions
+//  are visited bottom-up on the call graph so that the summary of a caller
+//  includes the ones of its callees. Declarations are summarized from their
+//  attributes; recursive functions are summarized conservatively.
+//
+//  A call is copyable if the callee is safe to speculate and writes at most
+//  memory reached through its pointer arguments, all of which are local to
+//  the caller (see isLocalPointer). followDeps and checkCalls accept
+//  copyable calls once summaries are set with setModRefSummaries.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef UTIL_ANALYSIS_MODREFSUMMARY_H
+#define UTIL_ANALYSIS_MODREFSUMMARY_H
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <map>
+
+using namespace std;
+using namespace llvm;
+
+namespace util {
+
+  struct FunctionSummary {
+    // May write memory reached through a pointer argument
+    bool WritesArgMemory;
+
+    // May write memory that is neither local nor reached through a pointer
+    // argument, e.g. globals
+    bool WritesOtherMemory;
+
+    // Always returns normally and has no effects besides its writes:
+    // no volatile or atomic accesses, no unwinding, no exit, no loops that
+    // may not terminate, and no loads or divisions that may trap
+    bool Speculatable;
+
+    bool writesMemory() const { return WritesArgMemory || WritesOtherMemory; }
+    bool isPure() const { return !writesMemory() && Speculatable; }
+  };
+
+  class ModRefSummaries {
+  public:
+    void analyze(Module &M);
+
+    // Summary of F, null if F was not analyzed
+    const FunctionSummary *getSummary(const Function *F) const;
+
+    // Returns true if Call may be duplicated into an access phase
+    bool isCopyableCall(CallInst *Call) const;
+
+  private:
+    map<const Function *, FunctionSummary> Summaries;
+
+    FunctionSummary summarize(Function &F) const;
+    FunctionSummary summarizeDeclaration(Function &F) const;
+  };
+
+  // Sets the summaries consulted by followDeps and checkCalls; null disables
+  // them. The summaries must outlive their use.
+  void setModRefSummaries(const ModRefSummaries *S);
+
+  // Returns true if summaries are set and the call Inst is copyable
+  bool isCopyableCall(Instruction *Inst);
+}
+
+#endif
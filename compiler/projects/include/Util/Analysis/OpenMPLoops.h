@@ -0,0 +1,60 @@
+//===------ Util/Analysis/OpenMPLoops.h - OpenMP worksharing loops -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file OpenMPLoops.h
+///
+/// \brief Statically scheduled OpenMP worksharing loops
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Clang outlines the body of a parallel region into a .omp_outlined.
+//  function. A statically scheduled worksharing loop in it asks the runtime
+//  for the chunk of the calling thread:
+//
+//    call void @__kmpc_for_static_init_4(%ident_t* @0, i32 %gtid, i32 34,
+//        i32* %.omp.is_last, i32* %.omp.lb, i32* %.omp.ub, i32* %.omp.stride,
+//        i32 1, i32 1)
+//
+//  and then runs the chunk loop from .omp.lb to .omp.ub. With a chunk size,
+//  a dispatch loop around it moves the bounds on by .omp.stride.
+//
+//  The bounds escape into the runtime call, so alias analysis lets every
+//  store of the loop write them, and the chunk loop reloads .omp.ub in each
+//  iteration. The runtime does not keep the pointers, however: only the
+//  init call and the stores of the outlined function itself write them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef UTIL_ANALYSIS_OPENMPLOOPS_H
+#define UTIL_ANALYSIS_OPENMPLOOPS_H
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+
+#include <vector>
+
+using namespace llvm;
+
+namespace util {
+  // Adds the __kmpc_for_static_init calls of F to Calls
+  void findStaticInitCalls(Function &F, std::vector<CallInst *> &Calls);
+
+  // Moves the loads of the bounds of the static init calls of F to the
+  // preheader of the outermost loop around them that does not write the
+  // bound. Returns the number of moved loads.
+  unsigned hoistChunkBoundLoads(Function &F, LoopInfo &LI);
+
+  // Adds the chunk loops of the static init calls of F to Loops: the
+  // outermost loops after the call that do not move the bounds on
+  void findStaticChunkLoops(Function &F, LoopInfo &LI, DominatorTree &DT,
+                            std::vector<Loop *> &Loops);
+}
+
+#endif
@@ -0,0 +1,79 @@
+//===----- Util/Annotation/LoopHints.h - Per-loop Clairvoyance hints -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file LoopHints.h
+///
+/// \brief Per-loop Clairvoyance hints in loop metadata
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  A loop is selected for the transformation by a clairvoyance.enable hint
+//  in its loop metadata, next to the llvm.loop hints:
+//
+//    br i1 %c, label %header, label %exit, !llvm.loop !0
+//    !0 = distinct !{!0, !1, !2, !3, !4}
+//    !1 = !{!"clairvoyance.enable", i1 true}
+//    !2 = !{!"clairvoyance.unroll", i32 4}
+//    !3 = !{!"clairvoyance.indir", i32 2}
+//    !4 = !{!"clairvoyance.type", !"spec"}
+//
+//  The unroll, indir and type hints are optional and override -unroll,
+//  -indir-thresh and the swoop type of the build for this loop only.
+//
+//  In the sources, the CLAIRVOYANCE(...) marker of
+//  experiments/swoop/sources/common/clairvoyance.h gives these hints, and
+//  -mark-loops moves them into the loop metadata.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef UTIL_ANNOTATION_LOOPHINTS_H
+#define UTIL_ANNOTATION_LOOPHINTS_H
+
+#include "llvm/Analysis/LoopInfo.h"
+
+#include <string>
+
+using namespace llvm;
+
+namespace util {
+
+  struct ClairvoyanceHints {
+    bool Enable = false;
+
+    // Whether a clairvoyance.enable hint was found at all
+    bool HasEnable = false;
+
+    // Unroll count, valid if HasUnroll
+    unsigned Unroll = 0;
+    bool HasUnroll = false;
+
+    // Max number of indirections, valid if HasIndir
+    unsigned Indir = 0;
+    bool HasIndir = false;
+
+    // Swoop type, e.g. "consv" or "spec", empty if not given
+    std::string Type;
+  };
+
+  // Reads the hints in the loop metadata of L. Returns true if L has any.
+  bool getClairvoyanceHints(const Loop *L, ClairvoyanceHints &Hints);
+
+  // Reads the hints of L and its parents. The hints of an outer loop apply
+  // to all of its inner loops, unless an inner loop gives its own.
+  bool getClairvoyanceHintsInNest(const Loop *L, ClairvoyanceHints &Hints);
+
+  // Replaces the hints in the loop metadata of L by Hints, keeping any other
+  // loop hint
+  void setClairvoyanceHints(Loop *L, const ClairvoyanceHints &Hints);
+
+  // Returns true if any loop of LI has a clairvoyance.enable hint
+  bool hasClairvoyanceLoops(const LoopInfo &LI);
+}
+
+#endif
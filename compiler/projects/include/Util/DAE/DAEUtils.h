@@ -69,9 +69,32 @@ namespace util {
                  map<LoadInst *, pair<CastInst *, CallInst *>> &prefs,
 		 unsigned Threshold);
 
+  // Inserts prefetches for the access intrinsic I (see isAccessIntrinsic):
+  // one per lane of a gather, the first and the last byte of a masked load,
+  // and the first Lines cache lines of the source of a memcpy or memmove.
+  // The prefetches and all dependencies of I will also be inserted in
+  // toKeep, I itself is not.
+  // Returns the result of the insertion.
+  PrefInsertResult
+    insertIntrinsicPrefetch(AliasAnalysis *AA, IntrinsicInst *I, set<Instruction *> &toKeep,
+                            unsigned Threshold, unsigned LineSize, unsigned Lines);
+
   // Adds pointer to all LoadInsts in F to LoadList.
   void findLoads(Function &F, list<LoadInst *> &LoadList);
 
+  // Returns true if I reads memory through one of the intrinsics the access
+  // phase prefetches for: llvm.masked.gather, llvm.masked.load, llvm.memcpy
+  // and llvm.memmove.
+  bool isAccessIntrinsic(Instruction *I);
+
+  // Returns the address the access intrinsic I reads from: the vector of
+  // pointers of a gather, the pointer of a masked load, the source of a
+  // memcpy or memmove.
+  Value *getAccessIntrinsicAddress(IntrinsicInst *I);
+
+  // Adds pointer to all access intrinsics in F to List.
+  void findAccessIntrinsics(Function &F, list<IntrinsicInst *> &List);
+
   // Adds LoadInsts in LoadList to VisList if they
   // operate on visible data.
   void findVisibleLoads(list<LoadInst *> &LoadList, list<LoadInst *> &VisList);
@@ -0,0 +1,54 @@
+//===----- Util/Pipeline/SharedOptions.h - Options of several passes -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file SharedOptions.h
+///
+/// \brief Command line options read by more than one pass
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  An option can only be registered once per process. The options below are
+//  defined in SharedOptions.cpp, which every library of a pass reading them
+//  is built with, so that all passes can be built into the one library of
+//  the SWOOP pipeline (see SWOOP/Pipeline/SwoopPipeline.cpp) as well.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef UTIL_PIPELINE_SHAREDOPTIONS_H
+#define UTIL_PIPELINE_SHAREDOPTIONS_H
+
+#include "llvm/Support/CommandLine.h"
+
+#include <string>
+
+using namespace llvm;
+
+// -bench-name: the benchmark name
+extern cl::opt<std::string> BenchName;
+
+// -loop-name: the keyword identifying the headers of the loops to annotate
+// and unroll
+extern cl::opt<std::string> LoopName;
+
+// -unroll=auto: ForcedLoopUnroll chooses the unroll factor per loop and
+// records it in a clairvoyance.unroll hint, which the later passes read
+const unsigned UnrollAuto = 0;
+
+// Parses an unsigned unroll count, or "auto" as UnrollAuto
+class UnrollCountParser : public cl::parser<unsigned> {
+public:
+  UnrollCountParser(cl::Option &O) : cl::parser<unsigned>(O) {}
+
+  bool parse(cl::Option &O, StringRef ArgName, StringRef Arg, unsigned &Value);
+};
+
+// -unroll: the number of times the loop in focus is unrolled
+extern cl::opt<unsigned, false, UnrollCountParser> UnrollCount;
+
+#endif
@@ -31,14 +31,21 @@
 using namespace llvm;
 
 #include "../SkelUtils/Utils.cpp"
-
-static cl::opt<std::string> BenchName("bench-name",
-                                      cl::desc("The benchmark name"),
-                                      cl::value_desc("name"));
+#include "Util/Pipeline/SharedOptions.h"
 
 static cl::opt<bool> IsDae("is-dae",
                            cl::desc("Use depth-based DAE loop detection"));
 
+// The live-ins of an aggregated kernel are loaded from a struct at kernel
+// entry, and these loads end up in every phase, so kernels take them as
+// scalar arguments by default. LLVM's own -aggregate-extracted-args has the
+// same effect as this option.
+static cl::opt<bool> AggregateKernelArgs(
+    "aggregate-kernel-args",
+    cl::desc("Pass the live-ins of extracted loops through an aggregated "
+             "struct instead of as scalar arguments"),
+    cl::init(false));
+
 namespace {
 struct LoopExtract : public LoopPass {
   static char ID; // Pass identification, replacement for typeid
@@ -143,7 +150,7 @@ bool LoopExtract::runOnLoop(Loop *L, LPPassManager &LPM) {
 
   if (ShouldExtractLoop) {
 
-    CodeExtractor Extractor(DT, *L);
+    CodeExtractor Extractor(DT, *L, AggregateKernelArgs);
     Function *nF = Extractor.extractCodeRegion();
     if (nF != 0) {
       BasicBlock *codeRepl = getCaller(nF);
@@ -21,15 +21,16 @@ using namespace std;
 #include "llvm/Analysis/LoopAccessAnalysis.h"
 #include "../../../SWOOP/Utils/LongLatency.cpp"
 #include "DAE/Utils/SkelUtils/headers.h"
+#include "Util/Annotation/LoopHints.h"
 #include <algorithm>
 #include <llvm/IR/BasicBlock.h>
 
-void declareExternalGlobal(Value *v, int val);
-bool toBeDAE(Function *F);
-bool isDAEkernel(Function *F);
-bool isMain(Function *F);
+inline void declareExternalGlobal(Value *v, int val);
+inline bool toBeDAE(Function *F);
+inline bool isDAEkernel(Function *F);
+inline bool isMain(Function *F);
 
-bool isDAEkernel(Function *F) {
+inline bool isDAEkernel(Function *F) {
   bool ok = false;
   size_t found = F->getName().str().find("_clone");
   size_t found1 = F->getName().str().find("__kernel__");
@@ -38,7 +39,7 @@ bool isDAEkernel(Function *F) {
   return ok;
 }
 
-void declareExternalGlobal(Value *v, int val) {
+inline void declareExternalGlobal(Value *v, int val) {
   std::string path = "Globals.ll";
   std::error_code err;
   llvm::raw_fd_ostream out(path.c_str(), err, llvm::sys::fs::F_Append);
@@ -194,14 +195,59 @@ private:
   const Loop *TheLoop;
 };
 
-int loopToBeDAE(Loop *L, std::string benchmarkName,
-                bool requireDelinquent = true) {
+// The delinquent loads of L are the ones marked long latency or, if no load
+// of its function is marked, the ones whose address changes in L
+inline bool hasDelinquentLoads(Loop *L) {
+  Function *F = L->getHeader()->getParent();
+  bool Marked = false;
+  for (inst_iterator iI = inst_begin(F), iE = inst_end(F); iI != iE; ++iI) {
+    if (isa<LoadInst>(&*iI) && isLongLatency(&*iI)) {
+      Marked = true;
+      break;
+    }
+  }
+
+  for (BasicBlock *BB : L->blocks()) {
+    for (Instruction &I : *BB) {
+      LoadInst *LD = dyn_cast<LoadInst>(&I);
+      if (LD && (Marked ? isLongLatency(LD)
+                        : !L->isLoopInvariant(LD->getPointerOperand()))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
 
-  // Only accept inner-most loops
+// ByHint is set if L is selected by a clairvoyance hint rather than the
+// legacy marking
+inline bool loopIsSelected(Loop *L, bool allowOuter, bool &ByHint) {
+  ByHint = true;
+  // Only accept inner-most loops, or, if allowOuter is set, loops around
+  // inner-most loops that carry a clairvoyance.enable hint themselves
   if (L->getSubLoops().size() != 0) {
-    return false;
+    util::ClairvoyanceHints OwnHints;
+    if (!allowOuter || !util::getClairvoyanceHints(L, OwnHints) ||
+        !OwnHints.Enable) {
+      return false;
+    }
+    for (Loop *SubLoop : L->getSubLoops()) {
+      if (SubLoop->getSubLoops().size() != 0) {
+        return false;
+      }
+    }
+    return true;
   }
       
+  // A clairvoyance.enable hint on the loop or on one of its parents selects
+  // it, and a clairvoyance.enable hint set to false deselects it
+  util::ClairvoyanceHints CHints;
+  if (util::getClairvoyanceHintsInNest(L, CHints) && CHints.HasEnable) {
+    return CHints.Enable;
+  }
+
+  // Legacy marking: a vectorize.width hint of at least 1337
+  ByHint = false;
   int MAGIC_TRANSFORM = 1337;
 
   // If any of the parent loops has a hint,
@@ -218,9 +264,21 @@ int loopToBeDAE(Loop *L, std::string benchmarkName,
   return false;
 }
 
-bool isMain(Function *F) { return F->getName().str().compare("main") == 0; }
+// A loop selected by a clairvoyance hint is only transformed if it has
+// delinquent loads, unless requireDelinquent is unset. Loops with the legacy
+// marking are always transformed.
+inline int loopToBeDAE(Loop *L, std::string benchmarkName,
+                       bool requireDelinquent = true, bool allowOuter = false) {
+  bool ByHint;
+  if (!loopIsSelected(L, allowOuter, ByHint)) {
+    return false;
+  }
+  return !ByHint || !requireDelinquent || hasDelinquentLoads(L);
+}
+
+inline bool isMain(Function *F) { return F->getName().str().compare("main") == 0; }
 
-bool toBeDAE(Function *F) {
+inline bool toBeDAE(Function *F) {
   bool ok = false;
 
   /*401.bzip*/
@@ -0,0 +1,169 @@
+//===------ SwoopPipeline.cpp - The SWOOP flow as one clang plugin --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file SwoopPipeline.cpp
+///
+/// \brief Runs marking, extraction and the swoop passes in one compile
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  The library holds all passes of the flow in Makefile.defaults and adds
+//  them to the end of the optimization pipeline of clang, in the order of
+//  the Makefile steps, followed by the -O3 run on the result:
+//
+//    clang -O3 -Xclang -load -Xclang libSwoopPipeline.so \
+//        -mllvm -swoop-type=consv -mllvm -unroll=2 -mllvm -indir-thresh=1 \
+//        -c kernel.c
+//
+//  Nothing is added without -swoop-type. The options the Makefile passes
+//  to every step are the defaults, e.g. -hoist-delinquent=false; any of
+//  them can be overridden with -mllvm, like all other options of the
+//  passes. The pipeline is not added at -O0.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/BasicAliasAnalysis.h"
+#include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/ScalarEvolutionAliasAnalysis.h"
+#include "llvm/Analysis/TypeBasedAliasAnalysis.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/PassInfo.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/UnifyFunctionExitNodes.h"
+
+using namespace llvm;
+
+namespace {
+// The swoop pass of each swoop type, and the option it is built with, see
+// the <type>_options in Makefile.defaults
+struct SwoopTypeInfo {
+  const char *Type;
+  const char *Pass;
+  const char *Option;
+};
+
+const SwoopTypeInfo SwoopTypes[] = {
+    {"consv", "dae-swoop", nullptr},
+    {"specsafe", "aggressive-swoop", nullptr},
+    {"spec", "speculative-swoop", nullptr},
+    {"multispecsafe", "aggressive-swoop", "multi-access"},
+    {"multispec", "speculative-swoop", "multi-access"},
+    {"rtcheck", "dae-swoop", "runtime-alias-checks"},
+    {"chase", "chase-swoop", nullptr},
+    {"smart", "smartdae", nullptr},
+};
+
+// Set while the -O3 run after the swoop pass is populated, which would add
+// the pipeline once more
+bool Populating = false;
+}
+
+static cl::Option *getOption(StringRef Name) {
+  StringMap<cl::Option *> &Options = cl::getRegisteredOptions();
+  auto O = Options.find(Name);
+  return O == Options.end() ? nullptr : O->second;
+}
+
+// Gives option Name the value Value, unless it is given on the command line
+static void setDefault(StringRef Name, StringRef Value) {
+  cl::Option *O = getOption(Name);
+  if (O && !O->getNumOccurrences()) {
+    O->addOccurrence(0, Name, Value);
+  }
+}
+
+static void addPass(legacy::PassManagerBase &PM, StringRef Name) {
+  const PassInfo *PI = PassRegistry::getPassRegistry()->getPassInfo(Name);
+  if (!PI) {
+    errs() << "SWOOP pipeline: no pass " << Name << "\n";
+    return;
+  }
+  PM.add(PI->createPass());
+}
+
+static void addSwoopPipeline(const PassManagerBuilder &Builder,
+                             legacy::PassManagerBase &PM) {
+  if (Populating) {
+    return;
+  }
+
+  // -swoop-type is an option of the swoop passes
+  cl::Option *TypeOption = getOption("swoop-type");
+  if (!TypeOption || !TypeOption->getNumOccurrences()) {
+    return;
+  }
+  std::string Type = *static_cast<cl::opt<std::string> *>(TypeOption);
+
+  const SwoopTypeInfo *Info = nullptr;
+  for (const SwoopTypeInfo &T : SwoopTypes) {
+    if (Type == T.Type) {
+      Info = &T;
+    }
+  }
+  if (!Info) {
+    errs() << "SWOOP pipeline: unknown swoop type " << Type << "\n";
+    return;
+  }
+
+  if (Info->Option) {
+    setDefault(Info->Option, "true");
+  }
+  setDefault("require-delinquent", "false");
+  setDefault("loop-name", "__kernel__");
+  setDefault("hoist-delinquent", "false");
+  setDefault("merge-branches", "true");
+  setDefault("branch-prob-threshold", "0.9");
+
+  // %.marked.ll
+  addPass(PM, "mark-loops");
+
+  // %.annotated.ll
+  addPass(PM, "annotate-cfg-indir");
+
+  // %.unroll.ll
+  PM.add(createLoopUnswitchPass());
+  PM.add(createInstructionCombiningPass());
+  PM.add(createLCSSAPass());
+  PM.add(createLoopSimplifyPass());
+  PM.add(createLoopRotatePass());
+  PM.add(createIndVarSimplifyPass());
+  PM.add(createLICMPass());
+  PM.add(createLCSSAPass());
+  addPass(PM, "single-loop-unroll");
+
+  // %.extract.ll
+  addPass(PM, "second-loop-extract");
+  PM.add(createUnifyFunctionExitNodesPass());
+  addPass(PM, "branchannotate");
+
+  // %.<type>.ll
+  PM.add(createTypeBasedAAWrapperPass());
+  PM.add(createBasicAAWrapperPass());
+  PM.add(createGlobalsAAWrapperPass());
+  PM.add(createSCEVAAWrapperPass());
+  addPass(PM, Info->Pass);
+  PM.add(createPromoteMemoryToRegisterPass());
+
+  // %.O3.ll
+  PassManagerBuilder Cleanup;
+  Cleanup.OptLevel = Builder.OptLevel;
+  Cleanup.SizeLevel = Builder.SizeLevel;
+  Cleanup.Inliner = createFunctionInliningPass(Builder.OptLevel, Builder.SizeLevel);
+  Populating = true;
+  Cleanup.populateModulePassManager(PM);
+  Populating = false;
+}
+
+static RegisterStandardPasses
+    RegisterSwoopPipeline(PassManagerBuilder::EP_OptimizerLast, addSwoopPipeline);
@@ -17,12 +17,17 @@
 //  are hoisted depends on the flavour:
 //  - Aggressive Swoop
 //  - Speculative Swoop
+//  The file also holds the flavours that differ from the basic version in
+//  other ways:
+//  - SmartDAE
+//  - Chase Swoop
 //
 //===----------------------------------------------------------------------===//
 
 #include "SWOOP/Transform/SwoopDAE/BasicSwoop.h"
 #include "../SwoopDAE/LCDHandler.h"
 #include "../SwoopDAE/FindInstructions.h"
+#include "../SwoopDAE/PointerChase.h"
 
 
 using namespace util;
@@ -72,7 +77,7 @@ void OptimisticSwoop::divideLoads(list<LoadInst *> &toHoist,
     set<Instruction *> Deps;
     getRequirementsInIteration(AA, LI, L, Deps);
 
-    bool depNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::NoLCD);
+    bool depNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::NoLCD, UnrollCount);
     LCDResult SelfLCDRes = getLCDInfo(AA, LI, L, UnrollCount);
 
     if (SelfLCDRes == LCDResult::NoLCD && depNoLCD) {
@@ -102,7 +107,7 @@ void OptimisticSwoop::filterLoadsOnLCD(AliasAnalysis *AA,
     set<Instruction *> Deps;
     getRequirementsInIteration(AA, LI, *L, Deps);
     LCDResult selfLCD = getLCDInfo(AA, LI, *L, UnrollCount);
-    bool depsNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::NoLCD);
+    bool depsNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::NoLCD, UnrollCount);
 
     if (selfLCD == LCDResult::MustLCD) {
       ++L;
@@ -117,7 +122,7 @@ void OptimisticSwoop::filterLoadsOnLCD(AliasAnalysis *AA,
       continue;
     }
 
-    bool depsMayOrNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::MayLCD);
+    bool depsMayOrNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::MayLCD, UnrollCount);
     if (!depsMayOrNoLCD) {
       // dependencies contain must lcd, don't include load
       ++L;
@@ -291,5 +296,27 @@ void SmartDAE::selectInstructionsToReuseInExecute(Function *F, set<Instruction*>
 char SmartDAE::ID = 0;
 static RegisterPass<SmartDAE>
     F("smartdae", "Hoisting and prefetching all may & no aliases. Reuse none.", false, false);
+
+//===----------------------------------------------------------------------===//
+// ChaseSwoop implementation: chase the nodes ahead of loops that traverse a
+// linked structure (see PointerChase.h), conservative swoop for all others.
+
+namespace {
+struct ChaseSwoop : public SwoopDAE {
+  static char ID;
+  ChaseSwoop() : SwoopDAE() {}
+
+protected:
+  bool swoopifyTraversal(Function &F, list<LoadInst *> &Loads) override;
+};
+}
+
+bool ChaseSwoop::swoopifyTraversal(Function &F, list<LoadInst *> &Loads) {
+  return runAheadPointerChase(AA, LI, F, Loads);
+}
+
+char ChaseSwoop::ID = 0;
+static RegisterPass<ChaseSwoop>
+    G("chase-swoop", "Chasing ahead of linked structure traversals.", false, false);
 }
 
@@ -59,6 +59,10 @@ void insertMissingIncomingForOriginal(BasicBlock *accessBody, BasicBlock *execut
 void replaceDuplicatePhiNodes(Loop *L);
 
 BasicBlock *getExitingBlock(BasicBlock *latch);
+void splitUnifiedReturn(Function &F);
+bool getReturningExits(Loop *L, SmallVectorImpl<BasicBlock *> &Exits);
+BasicBlock *getMainExit(Loop *L, SmallVectorImpl<BasicBlock *> &Exits);
+void insertExitPhiNodes(Loop *L, DominatorTree *DT, BasicBlock *Exit);
 
 void insertMissingPhiNodesForDomination(Loop *L, DominatorTree *DT,
                                         vector<BasicBlock *> &executeBlocks,
@@ -157,6 +161,75 @@ BasicBlock *getExitingBlock(BasicBlock *latch) {
   return executeBodyEnd;
 }
 
+// -mergereturn leaves the exits of an extracted loop with several exits
+// branching to one UnifiedReturnBlock, which only returns the value of a phi
+// node. Gives each of them its own return of its incoming value again.
+void splitUnifiedReturn(Function &F) {
+  vector<BasicBlock *> Unified;
+  for (Function::iterator i = F.begin(), e = F.end(); i != e; ++i) {
+    BasicBlock *BB = &*i;
+    ReturnInst *RI = dyn_cast<ReturnInst>(BB->getTerminator());
+    if (!RI || BB == &F.getEntryBlock() || pred_begin(BB) == pred_end(BB)) {
+      continue;
+    }
+
+    // Nothing but the phi node of the returned value, if any, and the return
+    PHINode *PN = dyn_cast_or_null<PHINode>(RI->getReturnValue());
+    Instruction *First = &BB->front();
+    if (First != RI &&
+        (First != PN || PN->getNextNode() != RI || !PN->hasOneUse())) {
+      continue;
+    }
+
+    bool AllBranch = true;
+    for (auto P = pred_begin(BB), PE = pred_end(BB); P != PE; ++P) {
+      BranchInst *BI = dyn_cast<BranchInst>((*P)->getTerminator());
+      AllBranch &= BI && BI->isUnconditional();
+    }
+    if (AllBranch) {
+      Unified.push_back(BB);
+    }
+  }
+
+  for (BasicBlock *BB : Unified) {
+    Value *RetVal = cast<ReturnInst>(BB->getTerminator())->getReturnValue();
+    PHINode *PN = dyn_cast_or_null<PHINode>(RetVal);
+
+    vector<BasicBlock *> Preds(pred_begin(BB), pred_end(BB));
+    for (BasicBlock *Pred : Preds) {
+      Value *V = PN ? PN->getIncomingValueForBlock(Pred) : RetVal;
+      ReplaceInstWithInst(Pred->getTerminator(),
+                          ReturnInst::Create(F.getContext(), V));
+    }
+    BB->eraseFromParent();
+  }
+}
+
+// Collects the exits of the extracted loop L, which should all return
+bool getReturningExits(Loop *L, SmallVectorImpl<BasicBlock *> &Exits) {
+  L->getUniqueExitBlocks(Exits);
+  for (BasicBlock *Exit : Exits) {
+    if (!isa<ReturnInst>(Exit->getTerminator())) {
+      return false;
+    }
+  }
+  return !Exits.empty();
+}
+
+// The exit taken after the last iteration: the one of the latch, or the
+// first one if the latch does not exit, as in loops that test in the header
+BasicBlock *getMainExit(Loop *L, SmallVectorImpl<BasicBlock *> &Exits) {
+  if (BasicBlock *Latch = L->getLoopLatch()) {
+    TerminatorInst *TI = Latch->getTerminator();
+    for (int i = 0; i < TI->getNumSuccessors(); ++i) {
+      if (!L->contains(TI->getSuccessor(i))) {
+        return TI->getSuccessor(i);
+      }
+    }
+  }
+  return Exits.front();
+}
+
 void insertInlineAssembly(LLVMContext &context, string &asmString,
                           Instruction *insertBeforeInstruction,
                           string &constraints) {
@@ -228,6 +301,41 @@ void insertMissingPhiNodesForDomination(
   }
 }
 
+// Routes the values of L used in Exit through LCSSA phi nodes. A value
+// defined before one early exit does not dominate the others: it is undefined
+// on the paths that do not define it, as in insertMissingPhiNodesForDomination.
+void insertExitPhiNodes(Loop *L, DominatorTree *DT, BasicBlock *Exit) {
+  map<Instruction *, PHINode *> ExitPN;
+
+  for (BasicBlock::iterator II = Exit->getFirstInsertionPt(), IE = Exit->end();
+       II != IE; ++II) {
+    Instruction *I = &*II;
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI) {
+      Instruction *VI = dyn_cast_or_null<Instruction>(*OI);
+      if (!VI || !L->contains(VI->getParent())) {
+        continue;
+      }
+
+      PHINode *&PN = ExitPN[VI];
+      if (!PN) {
+        map<BasicBlock *, Value *> ValToUseCache;
+        std::set<BasicBlock *> Succs;
+        gatherSuccessorsWithinLoop(VI->getParent(), Succs, L);
+
+        PN = PHINode::Create(VI->getType(), 0,
+                             Twine(VI->getName().str() + ".lcssa"),
+                             &(Exit->front()));
+        for (auto P = pred_begin(Exit), PE = pred_end(Exit); P != PE; ++P) {
+          PN->addIncoming(
+              findInsertionPoint(DT, *P, VI, Succs, ValToUseCache), *P);
+        }
+      }
+      OI->set(PN);
+    }
+  }
+}
+
 void replaceDuplicatePhiNodes(Loop *L) {
   for (auto BI = L->block_begin(), BE = L->block_end(); BI != BE; ++BI) {
     vector<PHINode *> uniquePhiNodes;
@@ -373,41 +481,43 @@ Value *findInsertionPoint(DominatorTree *DT, BasicBlock *UseBB,
     firstRun = false;
   } while (Use->getSinglePredecessor());
 
-  // Otherwise, a PHI might be necessary
-  list<pair<BasicBlock *, Value *>> IncomingVals;
-  bool allIncomingAreEqual = true;
-  Value *Incoming;
-
-  auto PI = pred_begin(Use), PE = pred_end(Use);
-  Incoming = findInsertionPoint(DT, *PI, Def, RelevantBlocks, ValToUseCache);
-  IncomingVals.push_back(make_pair(*PI, Incoming));
-  ++PI;
+  // Otherwise, a PHI might be necessary. Create it before visiting the
+  // predecessors: the walk may come back to Use through the backedge of an
+  // inner loop, and then finds the PHI in the cache.
+  PHINode *newPHI =
+      PHINode::Create(Def->getType(), 0, Twine(Def->getName().str() + ".phi"),
+                      &(Use->front()));
+  ValToUseCache[Use] = newPHI;
 
-  while (PI != PE) {
+  bool allIncomingAreEqual = true;
+  Value *Incoming = nullptr;
+  for (auto PI = pred_begin(Use), PE = pred_end(Use); PI != PE; ++PI) {
     Value *IncomingForPred =
         findInsertionPoint(DT, *PI, Def, RelevantBlocks, ValToUseCache);
-    IncomingVals.push_back(make_pair(*PI, IncomingForPred));
-    if (IncomingForPred != Incoming) {
+    newPHI->addIncoming(IncomingForPred, *PI);
+    if (IncomingForPred == newPHI) {
+      continue;
+    }
+    if (!Incoming) {
+      Incoming = IncomingForPred;
+    } else if (IncomingForPred != Incoming) {
       allIncomingAreEqual = false;
     }
-    ++PI;
   }
 
-  Value *ToUse;
-  if (allIncomingAreEqual) {
-    ToUse = Incoming;
-  } else {
-    PHINode *newPHI =
-        PHINode::Create(Def->getType(), 0, Twine(Def->getName().str() + ".phi"),
-                        &(Use->front()));
-    for (auto V = IncomingVals.begin(), VE = IncomingVals.end(); V != VE; ++V) {
-      newPHI->addIncoming((*V).second, (*V).first);
-    }
-    ToUse = newPHI;
+  if (!allIncomingAreEqual || !Incoming) {
+    return newPHI;
   }
 
-  ValToUseCache[Use] = ToUse;
-  return ToUse;
+  // The PHI is redundant, also for the blocks that were given it meanwhile
+  newPHI->replaceAllUsesWith(Incoming);
+  newPHI->eraseFromParent();
+  for (auto &Cached : ValToUseCache) {
+    if (Cached.second == newPHI) {
+      Cached.second = Incoming;
+    }
+  }
+  return Incoming;
 }
 
 BasicBlock *getExecuteLatch(BasicBlock *executeRoot, BasicBlock *executeBody) {
@@ -449,12 +559,23 @@ Loop *getLoop(Function &F, LoopInfo &LI) {
 
 bool stitch(Function &F, Function &ToAppend, ValueToValueMapTy &VMap, ValueToValueMapTy &VMapRev, LoopInfo &LI, DominatorTree &DT,
             bool forceIncrement, string type, int phaseCount) {
+  // Each exit returns on its own, also after -mergereturn
+  splitUnifiedReturn(F);
+  splitUnifiedReturn(ToAppend);
+
   Loop *L = getLoop(F, LI);
   BasicBlock *accessLatch = L->getLoopLatch();
-  BasicBlock *accessExit = L->getUniqueExitBlock();
   BasicBlock *accessBody = L->getHeader();
   BasicBlock *accessRoot = L->getLoopPredecessor();
 
+  // A loop with early exits has several, each returning from the kernel
+  SmallVector<BasicBlock *, 4> AccessExits;
+  if (!getReturningExits(L, AccessExits)) {
+    errs() << "Expected the loop exits to return.\n";
+    return false;
+  }
+  BasicBlock *accessExit = getMainExit(L, AccessExits);
+
   BasicBlock *executeRoot = &(ToAppend.getEntryBlock());
   TerminatorInst *executeRootEnd = executeRoot->getTerminator();
   if (executeRootEnd->getNumSuccessors() != 1) {
@@ -465,7 +586,7 @@ bool stitch(Function &F, Function &ToAppend, ValueToValueMapTy &VMap, ValueToVal
   BasicBlock *executeBody = executeRootEnd->getSuccessor(0);
   BasicBlock *executeLatch = getExecuteLatch(executeRoot, executeBody);
   BasicBlock *executeBodyEnd = getExitingBlock(executeLatch);
-  BasicBlock *executeExit;
+  vector<BasicBlock *> executeExits;
 
   F.getBasicBlockList().splice(F.end(), ToAppend.getBasicBlockList());
   ToAppend.removeFromParent();
@@ -480,12 +601,13 @@ bool stitch(Function &F, Function &ToAppend, ValueToValueMapTy &VMap, ValueToVal
 
   for (Function::iterator i = F.begin(), e = F.end(); i != e; ++i) {
     BasicBlock *BB = &*i;
-    if (!L->contains(BB) && BB != accessExit &&
-        BB != accessRoot) { // Do not re-add access blocks
+    if (!L->contains(BB) && BB != accessRoot &&
+        find(AccessExits.begin(), AccessExits.end(), BB) ==
+            AccessExits.end()) { // Do not re-add access blocks
       if (isa<ReturnInst>(BB->getTerminator())) {
 
         // do not add to loop - it's already part of the function
-        executeExit = BB;
+        executeExits.push_back(BB);
       } else {
         L->addBasicBlockToLoop(BB, LI);
         executeBlocks.push_back(BB);
@@ -509,7 +631,9 @@ bool stitch(Function &F, Function &ToAppend, ValueToValueMapTy &VMap, ValueToVal
       bool isIntermediate = false;
       for (int i = 0; i < TI->getNumSuccessors(); ++i) {
         BasicBlock *S = TI->getSuccessor(i);
-        if (S != accessBody && S != accessExit) {
+        if (S != accessBody &&
+            find(AccessExits.begin(), AccessExits.end(), S) ==
+                AccessExits.end()) {
           isIntermediate = true;
         }
       }
@@ -542,10 +666,14 @@ bool stitch(Function &F, Function &ToAppend, ValueToValueMapTy &VMap, ValueToVal
     BranchInst::Create(accessExit, accessLatch);
   }
 
-  Instruction *AccessReturnI = accessExit->getTerminator();
-  BranchInst *AccessExitBI = BranchInst::Create(executeRoot);
-  ReplaceInstWithInst(AccessReturnI, AccessExitBI);
-  L->addBasicBlockToLoop(accessExit, LI);
+  // Leaving the access phase through any exit continues with the execute
+  // phase, which reaches the same exit again and takes it
+  for (BasicBlock *Exit : AccessExits) {
+    Instruction *AccessReturnI = Exit->getTerminator();
+    BranchInst *AccessExitBI = BranchInst::Create(executeRoot);
+    ReplaceInstWithInst(AccessReturnI, AccessExitBI);
+    L->addBasicBlockToLoop(Exit, LI);
+  }
 
   // Replace phi nodes in execute phase by values that should be used
   vector<BasicBlock *> accessReplaceWith, executeReplace;
@@ -611,15 +739,21 @@ bool stitch(Function &F, Function &ToAppend, ValueToValueMapTy &VMap, ValueToVal
   // all added basic blocks to the Loop are actually part of the loop..
   DT.recalculate(*(L->getHeader()->getParent()));
 
-  for (auto P = pred_begin(executeExit), PE = pred_end(executeExit); P != PE;
-       ++P) {
-    BasicBlock *Pred = *P;
-    if (!DT.dominates(Pred, executeExit) && L->contains(Pred)) {
-      vector<BasicBlock *> MissingPNBlock;
-      MissingPNBlock.push_back(Pred);
-      insertMissingPhiNodesForDomination(L, &DT, MissingPNBlock, executeRoot);
+  for (BasicBlock *executeExit : executeExits) {
+    insertExitPhiNodes(L, &DT, executeExit);
+  }
+
+  for (BasicBlock *executeExit : executeExits) {
+    for (auto P = pred_begin(executeExit), PE = pred_end(executeExit); P != PE;
+         ++P) {
+      BasicBlock *Pred = *P;
+      if (!DT.dominates(Pred, executeExit) && L->contains(Pred)) {
+        vector<BasicBlock *> MissingPNBlock;
+        MissingPNBlock.push_back(Pred);
+        insertMissingPhiNodesForDomination(L, &DT, MissingPNBlock, executeRoot);
 
-      L->removeBlockFromLoop(Pred);
+        L->removeBlockFromLoop(Pred);
+      }
     }
   }
 
@@ -630,12 +764,18 @@ bool stitchAEDecision(Function &F, Function &Optimized, ValueToValueMapTy &VMapR
 		      BasicBlock *DecisionBlock,
 		      LoopInfo &LI, DominatorTree &DT,
 		      string type, int phaseCount) {
+  // Each exit returns on its own, also after -mergereturn
+  splitUnifiedReturn(F);
+  splitUnifiedReturn(Optimized);
+
   Loop *L = getLoop(F, LI);
   BasicBlock *accessLatch = L->getLoopLatch();
-  BasicBlock *accessExit = L->getUniqueExitBlock();
   BasicBlock *accessBody = L->getHeader();
   BasicBlock *accessRoot = L->getLoopPredecessor();
 
+  SmallVector<BasicBlock *, 4> AccessExits;
+  L->getUniqueExitBlocks(AccessExits);
+
   BasicBlock *executeRoot = &(Optimized.getEntryBlock());
   TerminatorInst *executeRootEnd = executeRoot->getTerminator();
   if (executeRootEnd->getNumSuccessors() != 1) {
@@ -646,7 +786,7 @@ bool stitchAEDecision(Function &F, Function &Optimized, ValueToValueMapTy &VMapR
   BasicBlock *executeBody = executeRootEnd->getSuccessor(0);
   BasicBlock *executeLatch = getExecuteLatch(executeRoot, executeBody);
   BasicBlock *executeBodyEnd = getExitingBlock(executeLatch);
-  BasicBlock *executeExit;
+  vector<BasicBlock *> executeExits;
 
   F.getBasicBlockList().splice(F.end(), Optimized.getBasicBlockList());
   Optimized.removeFromParent();
@@ -661,12 +801,13 @@ bool stitchAEDecision(Function &F, Function &Optimized, ValueToValueMapTy &VMapR
 
   for (Function::iterator i = F.begin(), e = F.end(); i != e; ++i) {
     BasicBlock *BB = &*i;
-    if (!L->contains(BB) && BB != accessExit &&
-        BB != accessRoot) { // Do not re-add access blocks
+    if (!L->contains(BB) && BB != accessRoot &&
+        find(AccessExits.begin(), AccessExits.end(), BB) ==
+            AccessExits.end()) { // Do not re-add access blocks
       if (isa<ReturnInst>(BB->getTerminator())) {
 
         // do not add to loop - it's already part of the function
-        executeExit = BB;
+        executeExits.push_back(BB);
       } else {
         L->addBasicBlockToLoop(BB, LI);
         executeBlocks.push_back(BB);
@@ -690,7 +831,9 @@ bool stitchAEDecision(Function &F, Function &Optimized, ValueToValueMapTy &VMapR
       bool isIntermediate = false;
       for (int i = 0; i < TI->getNumSuccessors(); ++i) {
         BasicBlock *S = TI->getSuccessor(i);
-        if (S != accessBody && S != accessExit) {
+        if (S != accessBody &&
+            find(AccessExits.begin(), AccessExits.end(), S) ==
+                AccessExits.end()) {
           isIntermediate = true;
         }
       }
@@ -761,15 +904,21 @@ bool stitchAEDecision(Function &F, Function &Optimized, ValueToValueMapTy &VMapR
   // all added basic blocks to the Loop are actually part of the loop..
   DT.recalculate(*(L->getHeader()->getParent()));
 
-  for (auto P = pred_begin(executeExit), PE = pred_end(executeExit); P != PE;
-       ++P) {
-    BasicBlock *Pred = *P;
-    if (!DT.dominates(Pred, executeExit) && L->contains(Pred)) {
-      vector<BasicBlock *> MissingPNBlock;
-      MissingPNBlock.push_back(Pred);
-      insertMissingPhiNodesForDomination(L, &DT, MissingPNBlock, executeRoot);
+  for (BasicBlock *executeExit : executeExits) {
+    insertExitPhiNodes(L, &DT, executeExit);
+  }
+
+  for (BasicBlock *executeExit : executeExits) {
+    for (auto P = pred_begin(executeExit), PE = pred_end(executeExit); P != PE;
+         ++P) {
+      BasicBlock *Pred = *P;
+      if (!DT.dominates(Pred, executeExit) && L->contains(Pred)) {
+        vector<BasicBlock *> MissingPNBlock;
+        MissingPNBlock.push_back(Pred);
+        insertMissingPhiNodesForDomination(L, &DT, MissingPNBlock, executeRoot);
 
-      L->removeBlockFromLoop(Pred);
+        L->removeBlockFromLoop(Pred);
+      }
     }
   }
 
@@ -22,12 +22,19 @@
 #include "Util/DAE/DAEUtils.h"
 #include "../../Utils/LongLatency.cpp"
 #include "Util/Analysis/LoopCarriedDependencyAnalysis.h"
+#include "Util/Analysis/IndirectionDepth.h"
 #include "LCDHandler.h"
 
+// Compare the length of the longest chain of dependent loads, instead of
+// the number of loads among the data dependencies, to -indir-thresh
+static cl::opt<bool> IndirByDepth("indir-depth",
+                                  cl::desc("Apply the indirection threshold to the depth of the load chain"),
+                                  cl::init(false));
+
 void filterLoadsOnInterferingDeps(AliasAnalysis *AA, LoopInfo *LI, list<LoadInst *> &Loads,
                                   list<LoadInst *> &Hoistable, Function &F);
 void filterLoadsOnIndir(AliasAnalysis *AA, LoopInfo *LI, list<LoadInst *> &LoadList, list<LoadInst *> &IndirList,
-                        unsigned int IndirThresh);
+                        unsigned int IndirThresh, IndirectionDepth &Depth);
 
 
 // Overwrite to only pick delinquent loads
@@ -56,12 +63,17 @@ void filterLoadsOnInterferingDeps(AliasAnalysis *AA, LoopInfo *LI, list<LoadInst
 }
 
 void filterLoadsOnIndir(AliasAnalysis *AA, LoopInfo *LI, list<LoadInst *> &LoadList, list<LoadInst *> &IndirList,
-                        unsigned int IndirThresh) {
+                        unsigned int IndirThresh, IndirectionDepth &Depth) {
   for (list<LoadInst *>::iterator I = LoadList.begin(), E = LoadList.end(); I != E; ++I) {
-    set<Instruction *> Deps;
-    getDeps(AA, LI, *I, Deps);
-    int DataIndirCount = count_if(Deps.begin(), Deps.end(),
-                                  [&](Instruction *DepI){return isa<LoadInst>(DepI) && LI->getLoopFor(DepI->getParent());});
+    int DataIndirCount;
+    if (IndirByDepth) {
+      DataIndirCount = Depth.getDepth(*I);
+    } else {
+      set<Instruction *> Deps;
+      getDeps(AA, LI, *I, Deps);
+      DataIndirCount = count_if(Deps.begin(), Deps.end(),
+                                [&](Instruction *DepI){return isa<LoadInst>(DepI) && LI->getLoopFor(DepI->getParent());});
+    }
     bool UnderDataThreshold = DataIndirCount <= IndirThresh;
     bool UnderCFGThreshold = !InstrhasMetadataKind(*I, "CFGIndir") ||
         stoi(getInstructionMD(*I, "CFGIndir")) <= IndirThresh;
@@ -84,8 +96,14 @@ void findAccessInsts(AliasAnalysis *AA, LoopInfo *LI, Function &fun, list<LoadIn
 
   findVisibleLoads(LoadList, VisibleList);
 
+  // Depth of the dependent load chains over all loads of the loop, so that
+  // loads that are not hoisted still count as indirections
+  IndirectionDepth Depth(AA, LI);
+  Depth.analyze(fun);
+  Depth.annotate();
+
   // Filter on the number of allowed indirections to hoist
-  filterLoadsOnIndir(AA, LI, VisibleList, IndirLoads, IndirThresh);
+  filterLoadsOnIndir(AA, LI, VisibleList, IndirLoads, IndirThresh, Depth);
   Indir = VisibleList.size() - IndirLoads.size();
 
   anotateStores(AA, fun, IndirLoads);
@@ -95,5 +113,49 @@ void findAccessInsts(AliasAnalysis *AA, LoopInfo *LI, Function &fun, list<LoadIn
 
   BadDeps = IndirLoads.size() - toHoist.size();
 
-  errs() << "(BadDeps: " << BadDeps << ", Indir: " << Indir << ")\n";
+  errs() << "(BadDeps: " << BadDeps << ", Indir: " << Indir
+         << ", MaxDepth: " << Depth.getMaxDepth() << ")\n";
+}
+
+void findAccessIntrinsicInsts(AliasAnalysis *AA, LoopInfo *LI, Function &fun, list<IntrinsicInst *> &toPrefetch,
+                              bool HoistDelinquent, unsigned int IndirThresh) {
+  list<IntrinsicInst *> Intrinsics;
+  findAccessIntrinsics(fun, Intrinsics);
+
+  unsigned int BadDeps = 0, Indir = 0;
+  for (IntrinsicInst *I : Intrinsics) {
+    if (!LI->getLoopFor(I->getParent()) || (HoistDelinquent && !isLongLatency(I))) {
+      continue;
+    }
+
+    // The pointers of a gather are a vector, visibility is only checked for
+    // scalar addresses
+    Value *Addr = getAccessIntrinsicAddress(I);
+    if (Addr->getType()->isPointerTy() && !isNonLocalPointer(Addr)) {
+      continue;
+    }
+
+    set<Instruction *> Deps;
+    getDeps(AA, LI, I, Deps);
+    unsigned DataIndirCount = count_if(Deps.begin(), Deps.end(),
+                                       [&](Instruction *DepI){return isa<LoadInst>(DepI) && LI->getLoopFor(DepI->getParent());});
+    if (DataIndirCount > IndirThresh) {
+      ++Indir;
+      continue;
+    }
+
+    set<Instruction *> Requirements, DepSet;
+    getRequirementsInIteration(AA, LI, I, Requirements);
+    if (!followDeps(AA, Requirements, DepSet)) {
+      ++BadDeps;
+      continue;
+    }
+
+    toPrefetch.push_back(I);
+  }
+
+  if (!Intrinsics.empty()) {
+    errs() << "Intrinsics: " << toPrefetch.size() << " of " << Intrinsics.size()
+           << " (BadDeps: " << BadDeps << ", Indir: " << Indir << ")\n";
+  }
 }
@@ -31,6 +31,10 @@ using namespace std;
 
 void findAccessInsts(AliasAnalysis *AA, LoopInfo *LI, Function &fun, list<LoadInst *> &toHoist, bool HoistDelinquent,
                      unsigned int IndirThresh);
+// Same as findAccessInsts, for the gathers, masked loads and memory copies
+// the access phase prefetches for (see util::isAccessIntrinsic)
+void findAccessIntrinsicInsts(AliasAnalysis *AA, LoopInfo *LI, Function &fun, list<IntrinsicInst *> &toPrefetch,
+                              bool HoistDelinquent, unsigned int IndirThresh);
 void findRelevantLoads(Function &F, list<LoadInst *> &LoadList, bool HoistDelinquent);
 
 #endif //PROJECT_FINDINSTRUCTIONS_H
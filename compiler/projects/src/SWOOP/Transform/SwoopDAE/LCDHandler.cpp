@@ -20,18 +20,91 @@
 
 #include <queue>
 #include "Util/Analysis/AliasUtils.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/ValueMap.h"
+#include "llvm/Support/CommandLine.h"
+
+static cl::opt<bool> LCDDisambiguation("lcd-disambiguation",
+                                       cl::desc("Use loop-carried dependency distances to disambiguate loads"),
+                                       cl::init(false));
+
+namespace {
+// LCD information of a single load, as reported by the LCD analysis
+struct LCDInfo {
+  LCDResult LCD;
+  bool HasDistance;
+  long int Distance;
+};
+
+// Entries are dropped when the instruction is deleted, and are not moved to
+// the replacement on RAUW (it is not necessarily a load with the same
+// dependencies).
+struct LCDInfoMapConfig : ValueMapConfig<const Instruction *> {
+  enum { FollowRAUW = false };
+};
+
+typedef ValueMap<const Instruction *, LCDInfo, LCDInfoMapConfig> LCDInfoMapTy;
+}
+
+static LCDInfoMapTy RecordedLCDInfo;
+
+static bool AssumeRuntimeChecked = false;
+
+bool isLCDDisambiguationEnabled() {
+  return LCDDisambiguation;
+}
+
+void recordLCDInfo(LoopCarriedDependencyAnalysis &LCDAnalysis, LoopInfo *LI, Function &F) {
+  clearLCDInfo();
+  for (inst_iterator I = inst_begin(F), IE = inst_end(F); I != IE; ++I) {
+    if (!isa<LoadInst>(&*I)) {
+      continue;
+    }
+
+    Loop *L = LI->getLoopFor(I->getParent());
+    if (!L) {
+      continue;
+    }
+
+    LCDInfo Info;
+    Info.LCD = LCDAnalysis.checkLCD(&*I, L);
+    Info.HasDistance = LCDAnalysis.getLCDDistance(&*I, L, Info.Distance);
+    RecordedLCDInfo.insert(make_pair(&*I, Info));
+  }
+}
+
+void mapLCDInfo(ValueToValueMapTy &VMap) {
+  vector<pair<const Instruction *, LCDInfo>> Mapped;
+  for (ValueToValueMapTy::iterator V = VMap.begin(), VE = VMap.end(); V != VE; ++V) {
+    Value *CloneV = V->second;
+    const Instruction *Orig = dyn_cast_or_null<Instruction>(V->first);
+    Instruction *Clone = dyn_cast_or_null<Instruction>(CloneV);
+    if (!Orig || !Clone) {
+      continue;
+    }
 
-#undef LCD_BASED_DISAMBIGUATION
+    LCDInfoMapTy::iterator Info = RecordedLCDInfo.find(Orig);
+    if (Info != RecordedLCDInfo.end()) {
+      Mapped.push_back(make_pair(Clone, Info->second));
+    }
+  }
 
-#ifdef LCD_BASED_DISAMBIGUATION
-static const char *LCD_TAG = "LCD";
-static const char *LCD_DISTANCE_TAG = "Distance";
-#endif
+  for (auto &M : Mapped) {
+    RecordedLCDInfo.insert(M);
+  }
+}
+
+void clearLCDInfo() {
+  RecordedLCDInfo.clear();
+}
+
+void setAssumeRuntimeChecked(bool Checked) {
+  AssumeRuntimeChecked = Checked;
+}
 
 
 AliasResult aliasWithStore(AliasAnalysis *AA, LoadInst *LInst, Loop *L) {
   BasicBlock *loadBB = LInst->getParent();
-  Value *Pointer = LInst->getPointerOperand();
   AliasResult AliasRes = AliasResult::NoAlias;
 
   // Keep track of which blocks we already visited
@@ -54,8 +127,7 @@ AliasResult aliasWithStore(AliasAnalysis *AA, LoadInst *LInst, Loop *L) {
       if (StoreInst::classof(&(*iI))) {
         StoreInst *SInst = (StoreInst * ) & (*iI);
 
-        switch (pointerAlias(AA, SInst->getPointerOperand(), Pointer,
-                             iI->getModule()->getDataLayout())) {
+        switch (instructionAlias(AA, SInst, LInst)) {
         case AliasResult::NoAlias:break; // Already default value.
         case AliasResult::MayAlias:
           if (AliasRes == AliasResult::NoAlias) {
@@ -91,11 +163,12 @@ AliasResult aliasWithStore(AliasAnalysis *AA, LoadInst *LInst, Loop *L) {
 // Returns true if the combined LCD from toCheck is at least the value of toExpect (or even
 // more flexible). I.e. MayAlias + NoAlias are MayAlias in combination, which in turn
 // is too unflexible for NoAlias, but would return true for MayAlias and MustAlias.
-bool expectAtLeast(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCheck, LCDResult toExpect) {
+bool expectAtLeast(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCheck, LCDResult toExpect,
+                   unsigned int UnrollCount) {
   set<Instruction *>::iterator I, IE;
   for (I = toCheck.begin(), IE = toCheck.end(); I != IE; ++I) {
     if (LI->getLoopFor((*I)->getParent())) {
-      if (getLCDInfo(AA, LI, *I, 0) > toExpect) {
+      if (getLCDInfo(AA, LI, *I, UnrollCount) > toExpect) {
         return false;
       }
     }
@@ -116,25 +189,22 @@ LCDResult getLCDInfo(AliasAnalysis *AA, LoopInfo *LI, Instruction *I, unsigned i
     return LCDResult::NoLCD;
   }
 
-#ifdef LCD_BASED_DISAMBIGUATION
-  // Do not consider the lcd analysis for now - only the alias
-  // analysis
-  if (InstrhasMetadataKind(I, LCD_TAG)) {
-     if (InstrhasMetadataKind(I, LCD_DISTANCE_TAG)) {
-       long int distance = stol(getInstructionMD(I, LCD_DISTANCE_TAG));
-      if (distance <= UnrollCount) {
-         LCDRes = fromString(getInstructionMD(I, LCD_TAG));
+  if (LCDDisambiguation) {
+    LCDInfoMapTy::iterator Info = RecordedLCDInfo.find(I);
+    if (Info != RecordedLCDInfo.end()) {
+      // All dependencies are further apart than the iterations the access
+      // phase runs ahead: they cannot affect this load. The alias check with
+      // the stores of the loop below still applies.
+      bool OutOfReach = Info->second.HasDistance &&
+                        Info->second.Distance > (long int)UnrollCount;
+      if (!OutOfReach) {
+        LCDRes = Info->second.LCD;
       }
-     }
-    else {
-       LCDRes = fromString(getInstructionMD(I, LCD_TAG));
-     }
-   }
-
-   if (LCDRes == LCDResult::MustLCD) {
-    return LCDRes;
-   }
-#endif
+      if (LCDRes == LCDResult::MustLCD) {
+        return LCDRes;
+      }
+    }
+  }
 
   AliasResult Alias =
       aliasWithStore(AA, (LoadInst *)I, LI->getLoopFor(I->getParent()));
@@ -144,7 +214,7 @@ LCDResult getLCDInfo(AliasAnalysis *AA, LoopInfo *LI, Instruction *I, unsigned i
     LCDStore = LCDResult::NoLCD;
     break;
   case MayAlias:
-    LCDStore = LCDResult::MayLCD;
+    LCDStore = AssumeRuntimeChecked ? LCDResult::NoLCD : LCDResult::MayLCD;
     break;
   case PartialAlias:
   case MustAlias:
@@ -161,12 +231,13 @@ LCDResult getLCDInfo(AliasAnalysis *AA, LoopInfo *LI, Instruction *I, unsigned i
 }
 
 
-LCDResult getLCDUnion(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCombine) {
+LCDResult getLCDUnion(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCombine,
+                      unsigned int UnrollCount) {
   LCDResult Res = LCDResult::NoLCD;
   set<Instruction *>::iterator I, IE;
   for (I = toCombine.begin(), IE = toCombine.end(); I != IE; ++I) {
     if (LI->getLoopFor((*I)->getParent())) {
-      Res = LoopCarriedDependencyAnalysis::combineLCD(getLCDInfo(AA, LI, *I, 0), Res);
+      Res = LoopCarriedDependencyAnalysis::combineLCD(getLCDInfo(AA, LI, *I, UnrollCount), Res);
     }
   }
 
@@ -21,6 +21,7 @@
 
 #include <set>
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
 #include "Util/Analysis/LoopCarriedDependencyAnalysis.h"
 
@@ -29,9 +30,26 @@ using namespace llvm;
 using namespace std;
 using namespace util;
 
-bool expectAtLeast(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCheck, LCDResult toExpect);
+bool expectAtLeast(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCheck, LCDResult toExpect,
+                   unsigned int UnrollCount);
 LCDResult getLCDInfo(AliasAnalysis *AA, LoopInfo *LI, Instruction *I, unsigned int UnrollCount);
-LCDResult getLCDUnion(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCombine);
+LCDResult getLCDUnion(AliasAnalysis *AA, LoopInfo *LI, set<Instruction *> &toCombine,
+                      unsigned int UnrollCount);
+
+// LCD based disambiguation (-lcd-disambiguation): getLCDInfo additionally
+// consults the results of the loop-carried dependency analysis. They are
+// recorded for the kernel before it is cloned into phases (the analysis
+// itself is recomputed by the pass manager for every function queried
+// afterwards) and carried over to each clone through its VMap.
+bool isLCDDisambiguationEnabled();
+void recordLCDInfo(LoopCarriedDependencyAnalysis &LCDAnalysis, LoopInfo *LI, Function &F);
+void mapLCDInfo(ValueToValueMapTy &VMap);
+void clearLCDInfo();
+
+// While set, loads that only may alias a store of the loop are NoLCD: the
+// function being transformed only runs after runtime checks ruled out any
+// overlap between the two (-runtime-alias-checks).
+void setAssumeRuntimeChecked(bool Checked);
 
 
 #endif //PROJECT_LCDHANDLER_H
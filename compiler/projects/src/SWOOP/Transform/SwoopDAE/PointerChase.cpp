@@ -0,0 +1,295 @@
+//===------------ PointerChase.cpp - Run-ahead pointer chasing ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file PointerChase.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+// With a distance of K, the loop
+//
+//   header:  p = phi [p0, preheader], [p.next, latch]
+//            ... p->field ...
+//            p.next = load p->next
+//
+// becomes
+//
+//   prologue: for (i = 0; i < K; ++i)
+//               buf[i] = a; if (a) { prefetch(&a->field); a = a->next; }
+//   header:   p = phi [p0, prologue], [p.next, latch]
+//             buf[j % K] = a; if (a) { prefetch(&a->field); a = a->next; }
+//             ... p->field ...
+//             p.next = buf[(j + 1) % K]
+//
+// where a is node j + K, or null once the chase has passed the last node.
+//
+//===----------------------------------------------------------------------===//
+#include "PointerChase.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#include <set>
+#include <vector>
+
+using namespace std;
+
+static cl::opt<unsigned> ChaseDistance("chase-distance",
+                                       cl::desc("Number of nodes to chase ahead of the loop"),
+                                       cl::init(8));
+
+namespace {
+struct Traversal {
+  Loop *L;
+
+  // The node of the current iteration
+  PHINode *Node;
+
+  // Loads the node of the next iteration from Node
+  LoadInst *Next;
+
+  // Addresses of the fields of Node the loop reads
+  vector<Value *> Fields;
+};
+}
+
+// Returns true if Ptr is the address of a field of Node: Node itself, or
+// casts and constant offsets of it
+static bool isFieldOf(Value *Ptr, Value *Node) {
+  while (Ptr != Node) {
+    if (BitCastInst *Cast = dyn_cast<BitCastInst>(Ptr)) {
+      Ptr = Cast->getOperand(0);
+    } else if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(Ptr)) {
+      if (!GEP->hasAllConstantIndices()) {
+        return false;
+      }
+      Ptr = GEP->getPointerOperand();
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Computes the address of the field Field of Node for the node Other
+static Value *getFieldOf(Value *Field, Value *Node, Value *Other,
+                         IRBuilder<> &Builder) {
+  if (Field == Node) {
+    return Other;
+  }
+
+  Instruction *I = cast<Instruction>(Field);
+  Instruction *Clone = I->clone();
+  Clone->setOperand(0, getFieldOf(I->getOperand(0), Node, Other, Builder));
+  return Builder.Insert(Clone, I->getName() + ".ahead");
+}
+
+// Returns true if the loop is left when Node or the next node is null
+static bool exitsOnNull(Loop *L, PHINode *Node, LoadInst *Next) {
+  SmallVector<BasicBlock *, 4> ExitingBlocks;
+  L->getExitingBlocks(ExitingBlocks);
+  for (BasicBlock *Exiting : ExitingBlocks) {
+    BranchInst *BI = dyn_cast<BranchInst>(Exiting->getTerminator());
+    ICmpInst *Cmp = BI && BI->isConditional()
+                        ? dyn_cast<ICmpInst>(BI->getCondition()) : nullptr;
+    if (!Cmp || !Cmp->isEquality()) {
+      continue;
+    }
+
+    Value *Ptr = Cmp->getOperand(0);
+    if (isa<ConstantPointerNull>(Ptr)) {
+      Ptr = Cmp->getOperand(1);
+    } else if (!isa<ConstantPointerNull>(Cmp->getOperand(1))) {
+      continue;
+    }
+    if (Ptr == Node || Ptr == Next) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns true if no instruction in L may write the next field of a node
+static bool isNextReadOnly(AliasAnalysis *AA, Loop *L, LoadInst *Next) {
+  MemoryLocation Loc = MemoryLocation::get(Next);
+  for (BasicBlock *BB : L->blocks()) {
+    for (Instruction &I : *BB) {
+      if (I.mayWriteToMemory() && (AA->getModRefInfo(&I, Loc) & MRI_Mod)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool findTraversal(AliasAnalysis *AA, LoopInfo *LI, list<LoadInst *> &Loads,
+                          Traversal &T) {
+  vector<Loop *> Loops(LI->begin(), LI->end());
+  if (Loops.size() != 1) {
+    return false;
+  }
+
+  T.L = Loops.front();
+  BasicBlock *Latch = T.L->getLoopLatch();
+  if (!T.L->empty() || !T.L->getLoopPreheader() || !Latch) {
+    return false;
+  }
+
+  T.Node = nullptr;
+  for (BasicBlock::iterator I = T.L->getHeader()->begin(); isa<PHINode>(I); ++I) {
+    PHINode *PN = cast<PHINode>(&*I);
+    LoadInst *Next = dyn_cast<LoadInst>(PN->getIncomingValueForBlock(Latch));
+    if (PN->getType()->isPointerTy() && Next && Next->isSimple() &&
+        isFieldOf(Next->getPointerOperand(), PN) && exitsOnNull(T.L, PN, Next) &&
+        isNextReadOnly(AA, T.L, Next)) {
+      T.Node = PN;
+      T.Next = Next;
+      break;
+    }
+  }
+  if (!T.Node) {
+    return false;
+  }
+
+  set<Value *> Seen;
+  for (LoadInst *Load : Loads) {
+    Value *Ptr = Load->getPointerOperand();
+    if (Load != T.Next && T.L->contains(Load) && isFieldOf(Ptr, T.Node) &&
+        Seen.insert(Ptr).second) {
+      T.Fields.push_back(Ptr);
+    }
+  }
+  return true;
+}
+
+// Prefetches the fields of Ahead and returns its next node. Builder inserts
+// at the end of a block without terminator.
+static Value *chaseNode(Traversal &T, Value *Ahead, IRBuilder<> &Builder) {
+  Module *M = Builder.GetInsertBlock()->getModule();
+  LLVMContext &Context = M->getContext();
+  Type *I32 = Type::getInt32Ty(Context);
+  Value *PrefFun = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
+
+  for (Value *Field : T.Fields) {
+    Value *Ptr = getFieldOf(Field, T.Node, Ahead, Builder);
+    unsigned PtrAS = cast<PointerType>(Ptr->getType())->getAddressSpace();
+    Value *Cast = Builder.CreatePointerCast(Ptr, Type::getInt8PtrTy(Context, PtrAS));
+    Builder.CreateCall(PrefFun, {Cast, ConstantInt::get(I32, 0),                 // read
+                                 ConstantInt::get(I32, 3), ConstantInt::get(I32, 1)}); // data
+  }
+
+  Value *NextPtr = getFieldOf(T.Next->getPointerOperand(), T.Node, Ahead, Builder);
+  return Builder.CreateLoad(NextPtr, "chase.next");
+}
+
+// Ends Head with: store Ahead into slot Index of Buf, and, unless Ahead is
+// null, chase it in a new block. Returns the node after Ahead, or null, as a
+// phi node in Join.
+static PHINode *recordAndChase(Traversal &T, AllocaInst *Buf, Value *Ahead, Value *Index,
+                               BasicBlock *Head, BasicBlock *Join) {
+  LLVMContext &Context = Head->getContext();
+  Type *I64 = Type::getInt64Ty(Context);
+  Value *Null = ConstantPointerNull::get(cast<PointerType>(T.Node->getType()));
+
+  IRBuilder<> Builder(Head);
+  Value *Slot = Builder.CreateInBoundsGEP(Buf, {ConstantInt::get(I64, 0), Index});
+  Builder.CreateStore(Ahead, Slot);
+  Value *IsNull = Builder.CreateICmpEQ(Ahead, Null, "chase.end");
+
+  BasicBlock *Chase = BasicBlock::Create(Context, "chase.step", Head->getParent(), Join);
+  Builder.CreateCondBr(IsNull, Join, Chase);
+
+  Builder.SetInsertPoint(Chase);
+  Value *Next = chaseNode(T, Ahead, Builder);
+  Builder.CreateBr(Join);
+
+  PHINode *Advanced = PHINode::Create(T.Node->getType(), 2, "chase.ahead");
+  Join->getInstList().push_front(Advanced);
+  Advanced->addIncoming(Null, Head);
+  Advanced->addIncoming(Next, Chase);
+  return Advanced;
+}
+
+bool runAheadPointerChase(AliasAnalysis *AA, LoopInfo *LI, Function &F,
+                          list<LoadInst *> &Loads) {
+  Traversal T;
+  if (!findTraversal(AA, LI, Loads, T)) {
+    return false;
+  }
+
+  unsigned Distance = ChaseDistance ? ChaseDistance : 1;
+  LLVMContext &Context = F.getContext();
+  Type *I64 = Type::getInt64Ty(Context);
+  Type *NodeTy = T.Node->getType();
+  Loop *L = T.L;
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  Value *First = T.Node->getIncomingValueForBlock(Preheader);
+
+  AllocaInst *Buf = new AllocaInst(ArrayType::get(NodeTy, Distance), "chase.buf",
+                                   &*F.getEntryBlock().getFirstInsertionPt());
+
+  // Prologue: record the first Distance nodes
+  BasicBlock *PrologueExit = SplitBlock(Preheader, Preheader->getTerminator());
+  BasicBlock *Prologue = BasicBlock::Create(Context, "chase.prologue", &F, PrologueExit);
+  BasicBlock *PrologueLatch = BasicBlock::Create(Context, "chase.prologue.latch", &F, PrologueExit);
+  Preheader->getTerminator()->setSuccessor(0, Prologue);
+
+  IRBuilder<> Builder(Prologue);
+  PHINode *I = Builder.CreatePHI(I64, 2, "chase.i");
+  PHINode *Ahead = Builder.CreatePHI(NodeTy, 2, "chase.node");
+  PHINode *Advanced = recordAndChase(T, Buf, Ahead, I, Prologue, PrologueLatch);
+
+  Builder.SetInsertPoint(PrologueLatch);
+  Value *NextI = Builder.CreateAdd(I, ConstantInt::get(I64, 1));
+  Builder.CreateCondBr(Builder.CreateICmpULT(NextI, ConstantInt::get(I64, Distance)),
+                       Prologue, PrologueExit);
+  I->addIncoming(ConstantInt::get(I64, 0), Preheader);
+  I->addIncoming(NextI, PrologueLatch);
+  Ahead->addIncoming(First, Preheader);
+  Ahead->addIncoming(Advanced, PrologueLatch);
+
+  // Loop: record the node Distance iterations ahead and chase it
+  BasicBlock *Body = SplitBlock(Header, &*Header->getFirstInsertionPt(), nullptr, LI);
+  BasicBlock *Latch = L->getLoopLatch();
+  Header->getTerminator()->eraseFromParent();
+
+  Builder.SetInsertPoint(&Header->front());
+  PHINode *J = Builder.CreatePHI(I64, 2, "chase.j");
+  PHINode *LoopAhead = Builder.CreatePHI(NodeTy, 2, "chase.node");
+
+  Builder.SetInsertPoint(Header);
+  Value *Slot = Builder.CreateURem(J, ConstantInt::get(I64, Distance));
+  Value *NextJ = Builder.CreateAdd(J, ConstantInt::get(I64, 1));
+  PHINode *LoopAdvanced = recordAndChase(T, Buf, LoopAhead, Slot, Header, Body);
+  L->addBasicBlockToLoop(LoopAdvanced->getIncomingBlock(1), *LI);
+
+  J->addIncoming(ConstantInt::get(I64, 0), PrologueExit);
+  J->addIncoming(NextJ, Latch);
+  LoopAhead->addIncoming(Advanced, PrologueExit);
+  LoopAhead->addIncoming(LoopAdvanced, Latch);
+
+  // The next node was recorded Distance - 1 iterations ago
+  Builder.SetInsertPoint(T.Next);
+  Value *NextSlot = Builder.CreateInBoundsGEP(
+      Buf, {ConstantInt::get(I64, 0), Builder.CreateURem(NextJ, ConstantInt::get(I64, Distance))});
+  Value *Recorded = Builder.CreateLoad(NextSlot, T.Next->getName() + ".recorded");
+  T.Next->replaceAllUsesWith(Recorded);
+  T.Next->eraseFromParent();
+
+  errs() << "Chasing " << Distance << " node(s) ahead, prefetching " << T.Fields.size()
+         << " field(s).\n";
+  return true;
+}
@@ -0,0 +1,47 @@
+//===------------------------- PointerChase.h ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file PointerChase.h
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+// Run-ahead pointer chasing for loops that traverse a linked structure,
+// p = p->next. The access phase of such a loop cannot get ahead: the address
+// of the next iteration is the miss of the current one.
+//
+// Instead, a second pointer runs -chase-distance nodes ahead of the loop. In
+// every iteration it records its node in a ring buffer, prefetches the fields
+// of the node the loop reads, and moves on to the next node. The loop takes
+// its next node from the buffer rather than loading it. A prologue before the
+// loop fills the buffer with the first nodes.
+//
+// The traversal must end at a null node, so that the chase knows where to
+// stop, and nothing in the loop may write the next fields.
+//
+//===----------------------------------------------------------------------===//
+#ifndef PROJECT_POINTERCHASE_H
+#define PROJECT_POINTERCHASE_H
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <list>
+
+using namespace llvm;
+
+// Chases the nodes ahead of the loop of kernel F if it traverses a linked
+// structure, prefetching the fields read by Loads. Returns true if it did.
+bool runAheadPointerChase(AliasAnalysis *AA, LoopInfo *LI, Function &F,
+                          std::list<LoadInst *> &Loads);
+
+#endif //PROJECT_POINTERCHASE_H
@@ -0,0 +1,281 @@
+//===------- ScalarReplacement.cpp - Cross-iteration scalar replacement ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file ScalarReplacement.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+// A load L is replaced if there is a source S, a store or another load,
+// such that
+// 1) L and S are executed in every iteration and the loop is only left
+//    from its latch,
+// 2) S in iteration k accesses exactly the location L reads in iteration
+//    k + D, for a constant D > 0 (affine addresses with equal strides), and
+// 3) nothing else in the loop may write the object L reads from.
+// L then reads the value S stored or loaded D iterations earlier, or, in the
+// first D iterations, the value in memory before the loop.
+//
+// The header phi nodes that carry the value are kept in the access phase
+// and stitched to the execute phase like any other loop carried value, so
+// the value crosses the access/execute boundary in a register as well.
+//
+//===----------------------------------------------------------------------===//
+#include "ScalarReplacement.h"
+
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <vector>
+
+using namespace std;
+
+static cl::opt<unsigned> MaxDistance("scalar-replace-max-distance",
+                                     cl::desc("Max dependence distance of loads to replace"),
+                                     cl::init(2));
+
+namespace {
+struct Rotation {
+  LoadInst *Load;
+
+  // Value to rotate: the stored value, or the source load itself
+  Value *SourceValue;
+  unsigned Distance;
+};
+}
+
+static Value *getPointerOperand(Instruction *I) {
+  if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+    return Load->getPointerOperand();
+  }
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+static Type *getAccessType(Instruction *I) {
+  if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
+    return Store->getValueOperand()->getType();
+  }
+  return I->getType();
+}
+
+static bool isSimpleAccess(Instruction *I) {
+  if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+    return Load->isSimple();
+  }
+  StoreInst *Store = dyn_cast<StoreInst>(I);
+  return Store && Store->isSimple();
+}
+
+// Returns the number of iterations D such that Source in iteration k
+// accesses exactly the location Load reads in iteration k + D, 0 if there is
+// no such D > 0.
+static unsigned getDistance(ScalarEvolution *SE, Loop *L, LoadInst *Load,
+                            Instruction *Source) {
+  const SCEVAddRecExpr *LoadAR =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Load->getPointerOperand()));
+  const SCEVAddRecExpr *SourceAR =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(getPointerOperand(Source)));
+  if (!LoadAR || !SourceAR || LoadAR->getLoop() != L ||
+      SourceAR->getLoop() != L || !LoadAR->isAffine() || !SourceAR->isAffine()) {
+    return 0;
+  }
+
+  const SCEVConstant *Step =
+      dyn_cast<SCEVConstant>(LoadAR->getStepRecurrence(*SE));
+  if (!Step || Step != SourceAR->getStepRecurrence(*SE)) {
+    return 0;
+  }
+
+  const SCEVConstant *Diff =
+      dyn_cast<SCEVConstant>(SE->getMinusSCEV(SourceAR, LoadAR));
+  if (!Diff) {
+    return 0;
+  }
+
+  // Accesses of different iterations must not partially overlap
+  const DataLayout &DL = Load->getModule()->getDataLayout();
+  int64_t Stride = Step->getValue()->getSExtValue();
+  int64_t AbsStride = Stride < 0 ? -Stride : Stride;
+  int64_t Offset = Diff->getValue()->getSExtValue();
+  if (Stride == 0 || (int64_t)DL.getTypeStoreSize(Load->getType()) > AbsStride ||
+      Offset % Stride != 0) {
+    return 0;
+  }
+
+  int64_t Distance = Offset / Stride;
+  return Distance > 0 && Distance <= MaxDistance ? Distance : 0;
+}
+
+// Returns true if no instruction in L, other than Source, may write the
+// object that Load reads from, in any iteration
+static bool isOnlyWriter(AliasAnalysis *AA, Loop *L, LoadInst *Load,
+                         Instruction *Source) {
+  MemoryLocation Object(Load->getPointerOperand(), MemoryLocation::UnknownSize);
+  for (BasicBlock *BB : L->blocks()) {
+    for (Instruction &I : *BB) {
+      if (&I == Source || !I.mayWriteToMemory()) {
+        continue;
+      }
+
+      if (StoreInst *Store = dyn_cast<StoreInst>(&I)) {
+        MemoryLocation Written(Store->getPointerOperand(),
+                               MemoryLocation::UnknownSize);
+        if (AA->alias(Written, Object) != NoAlias) {
+          return false;
+        }
+      } else if (AA->getModRefInfo(&I, Object) & MRI_Mod) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Returns true if L is known to run at least Iterations + 1 iterations,
+// i.e. the load of iteration Iterations may be moved to the preheader
+static bool runsIteration(ScalarEvolution *SE, Loop *L, unsigned Iteration) {
+  if (Iteration == 0) {
+    return true;
+  }
+
+  const SCEV *BTC = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BTC)) {
+    return false;
+  }
+  return SE->isKnownPredicate(ICmpInst::ICMP_UGE, BTC,
+                              SE->getConstant(BTC->getType(), Iteration));
+}
+
+static bool findRotation(AliasAnalysis *AA, DominatorTree *DT,
+                         ScalarEvolution *SE, Loop *L, Rotation &R) {
+  BasicBlock *Latch = L->getLoopLatch();
+
+  vector<Instruction *> Accesses;
+  for (BasicBlock *BB : L->blocks()) {
+    if (!DT->dominates(BB, Latch)) {
+      continue;
+    }
+    for (Instruction &I : *BB) {
+      if (isSimpleAccess(&I)) {
+        Accesses.push_back(&I);
+      }
+    }
+  }
+
+  for (Instruction *I : Accesses) {
+    LoadInst *Load = dyn_cast<LoadInst>(I);
+    if (!Load) {
+      continue;
+    }
+
+    R.Load = Load;
+    R.Distance = 0;
+    for (Instruction *Source : Accesses) {
+      if (Source == Load || getAccessType(Source) != Load->getType()) {
+        continue;
+      }
+
+      unsigned Distance = getDistance(SE, L, Load, Source);
+      if (!Distance || (R.Distance && R.Distance <= Distance)) {
+        continue;
+      }
+
+      StoreInst *Store = dyn_cast<StoreInst>(Source);
+      if (!isOnlyWriter(AA, L, Load, Store) || !runsIteration(SE, L, Distance - 1)) {
+        continue;
+      }
+
+      R.Distance = Distance;
+      R.SourceValue = Store ? Store->getValueOperand() : Source;
+    }
+
+    if (R.Distance) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void rotate(ScalarEvolution *SE, Loop *L, Rotation &R) {
+  LoadInst *Load = R.Load;
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *Latch = L->getLoopLatch();
+  Instruction *InsertPt = Preheader->getTerminator();
+
+  // Values of the first Distance iterations, read before the loop
+  const SCEVAddRecExpr *AR = cast<SCEVAddRecExpr>(SE->getSCEV(Load->getPointerOperand()));
+  const SCEV *Step = AR->getStepRecurrence(*SE);
+  SCEVExpander Expander(*SE, Load->getModule()->getDataLayout(), "scalar.replace");
+
+  vector<Value *> Initial;
+  for (unsigned It = 0; It < R.Distance; ++It) {
+    const SCEV *Ptr = SE->getAddExpr(AR->getStart(),
+                                     SE->getMulExpr(SE->getConstant(Step->getType(), It), Step));
+    Value *PtrV = Expander.expandCodeFor(Ptr, Load->getPointerOperand()->getType(), InsertPt);
+    LoadInst *Init = new LoadInst(PtrV, Load->getName() + ".init", InsertPt);
+    Init->setAlignment(Load->getAlignment());
+    Initial.push_back(Init);
+  }
+
+  // Rot[0] is the value of Load; Rot[i] the one of i iterations later
+  vector<PHINode *> Rot;
+  for (unsigned It = 0; It < R.Distance; ++It) {
+    Rot.push_back(PHINode::Create(Load->getType(), 2, Load->getName() + ".rot",
+                                  &Header->front()));
+  }
+  for (unsigned It = 0; It < R.Distance; ++It) {
+    Rot[It]->addIncoming(Initial[It], Preheader);
+    Rot[It]->addIncoming(It + 1 < R.Distance ? (Value *)Rot[It + 1] : R.SourceValue, Latch);
+  }
+
+  SE->forgetLoop(L);
+  Load->replaceAllUsesWith(Rot[0]);
+  Load->eraseFromParent();
+}
+
+unsigned replaceLoadsWithDistance(AliasAnalysis *AA, LoopInfo *LI, DominatorTree *DT,
+                                  ScalarEvolution *SE, Function &F) {
+  vector<Loop *> Innermost;
+  vector<Loop *> Worklist(LI->begin(), LI->end());
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.back();
+    Worklist.pop_back();
+    if (L->empty()) {
+      Innermost.push_back(L);
+    }
+    Worklist.insert(Worklist.end(), L->begin(), L->end());
+  }
+
+  unsigned Replaced = 0;
+  for (Loop *L : Innermost) {
+    BasicBlock *Latch = L->getLoopLatch();
+    if (!L->getLoopPreheader() || !Latch || L->getExitingBlock() != Latch) {
+      continue;
+    }
+
+    // Each replacement changes the loop: search the next rotation from
+    // scratch
+    Rotation R;
+    while (findRotation(AA, DT, SE, L, R)) {
+      rotate(SE, L, R);
+      ++Replaced;
+    }
+  }
+
+  if (Replaced) {
+    errs() << "Scalar replaced " << Replaced << " load(s) with a constant dependence distance.\n";
+  }
+  return Replaced;
+}
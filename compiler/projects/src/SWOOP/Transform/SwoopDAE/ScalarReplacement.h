@@ -0,0 +1,39 @@
+//===----------------------- ScalarReplacement.h -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file ScalarReplacement.h
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+// Cross-iteration scalar replacement: a load that reads the value stored or
+// loaded a constant number of iterations D earlier is replaced by a chain of
+// D phi nodes in the loop header that rotate the value through registers.
+// The values of the first D iterations are loaded in the preheader.
+//
+//===----------------------------------------------------------------------===//
+#ifndef PROJECT_SCALARREPLACEMENT_H
+#define PROJECT_SCALARREPLACEMENT_H
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+
+using namespace llvm;
+
+// Replaces the loads in the innermost loops of F that have a constant
+// dependence distance of at most -scalar-replace-max-distance. Returns the
+// number of replaced loads.
+unsigned replaceLoadsWithDistance(AliasAnalysis *AA, LoopInfo *LI, DominatorTree *DT,
+                                  ScalarEvolution *SE, Function &F);
+
+#endif //PROJECT_SCALARREPLACEMENT_H
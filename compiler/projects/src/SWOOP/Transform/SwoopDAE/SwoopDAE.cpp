@@ -29,9 +29,20 @@
 #include "../../Utils/DCEutils.cpp"
 #include "LCDHandler.h"
 #include "FindInstructions.h"
+#include "ScalarReplacement.h"
 
+#include "Util/Analysis/IndirectionDepth.h"
+#include "Util/Analysis/LAALCDAnalysis.h"
+#include "Util/Analysis/ModRefSummary.h"
+#include "Util/Pipeline/SharedOptions.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Analysis/Loads.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/IR/IRBuilder.h"
 #include "Util/Transform/BranchMerge/BranchMerge.h"
@@ -66,13 +77,52 @@ static cl::opt<bool> MultiAccess("multi-access",
                                  cl::desc("Creating multi access phase"),
                                  cl::init(false));
 
-// Specifies the number of times the loop in focus was unrolled
-static cl::opt<unsigned> UnrollCount("unroll", cl::desc("Unroll count"),
-                                     cl::init(1));
-
 static cl::opt<bool> OptimizeBranches("merge-branches", cl::desc("If set, it will apply branch merge optimizations"),
 					  cl::Hidden);
 
+// Versions kernels with may-aliasing loads on runtime overlap checks
+static cl::opt<bool> RuntimeAliasChecks("runtime-alias-checks",
+                                        cl::desc("Reuse may-aliasing loads in a version guarded by runtime alias checks"),
+                                        cl::init(false));
+
+// Hoists conditional loads and prefetches of the access phase above their
+// branches where this cannot fault
+static cl::opt<bool> SpeculateAccess("speculate-access",
+                                     cl::desc("Hoist conditional accesses out of branches in the access phase"),
+                                     cl::init(false));
+
+// Hoists loop invariant loads and address computations out of the stitched
+// access/execute loop
+static cl::opt<bool> HoistInvariants("hoist-invariants",
+                                     cl::desc("Hoist invariant loads out of the stitched loop"),
+                                     cl::init(false));
+
+// Replaces loads with a constant dependence distance by values rotated
+// through registers before the loads to hoist are selected
+static cl::opt<bool> ScalarReplace("scalar-replace",
+                                   cl::desc("Scalar replace loads with a constant dependence distance"),
+                                   cl::init(false));
+
+// Accepts calls to helpers that only write local memory in the access phase
+static cl::opt<bool> CallSummaries("call-summaries",
+                                   cl::desc("Use interprocedural mod/ref summaries to accept calls to helpers"),
+                                   cl::init(false));
+
+// Kernels whose loop is tuned for another swoop type are left unchanged
+static cl::opt<std::string> SwoopType("swoop-type",
+                                      cl::desc("Swoop type of this build, matched against clairvoyance.type loop hints"),
+                                      cl::value_desc("type"));
+
+// Cache lines prefetched at the start of the source of a memcpy or memmove
+// in the access phase, and their size
+static cl::opt<unsigned> CopyPrefetchLines("copy-prefetch-lines",
+                                           cl::desc("Number of cache lines to prefetch of each copied source"),
+                                           cl::init(2));
+
+static cl::opt<unsigned> CacheLineSize("cache-line-size",
+                                       cl::desc("Cache line size in bytes"),
+                                       cl::init(64));
+
 static cl::opt<float> BranchProbThreshold("branch-prob-threshold",
                                           cl::desc("Reduce branch if branch_prob > branch-prob-threshold. Should be larger or equal to 0.5."),
                                           cl::init(0.5));
@@ -122,17 +172,26 @@ void SwoopDAE::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<PostDominatorTree>();
   AU.addRequired<AssumptionCacheTracker>();
   AU.addRequired<TargetLibraryInfoWrapperPass>();
+  if (isLCDDisambiguationEnabled()) {
+    AU.addRequired<LoopCarriedDependencyAnalysisWrapperPass>();
+  }
+  if (RuntimeAliasChecks) {
+    AU.addRequired<LoopAccessAnalysis>();
+  }
+  if (ScalarReplace) {
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+  }
 }
 
 bool SwoopDAE::runOnModule(Module &M) {
   bool change = false;
 
+  // Collect the kernels first: versioning adds functions to the module
+  vector<Function *> Kernels;
   for (Module::iterator fI = M.begin(), fE = M.end(); fI != fE; ++fI) {
     // Check if function should be swoopified
     if (isSwoopKernel(*fI)) {
-      errs() << "\n";
-      errs() << fI->getName() << ":\n";
-      change |= swoopify(*fI);
+      Kernels.push_back(&*fI);
     }
     else if (isMain(*fI)) {
       //        insertCallInitPAPI(&*fI);
@@ -140,9 +199,134 @@ bool SwoopDAE::runOnModule(Module &M) {
     }
   }
 
+  // Summarize the callees before any kernel is cloned
+  ModRefSummaries Summaries;
+  if (CallSummaries) {
+    Summaries.analyze(M);
+    setModRefSummaries(&Summaries);
+  }
+
+  for (Function *F : Kernels) {
+    errs() << "\n";
+    errs() << F->getName() << ":\n";
+
+    Function *Overlap, *Disjoint;
+    if (RuntimeAliasChecks && versionOnRuntimeChecks(*F, Overlap, Disjoint)) {
+      change = true;
+      errs() << "Versioned on runtime alias checks.\n";
+      swoopify(*Overlap);
+
+      setAssumeRuntimeChecked(true);
+      swoopify(*Disjoint);
+      setAssumeRuntimeChecked(false);
+    } else {
+      change |= swoopify(*F);
+    }
+  }
+
+  setModRefSummaries(nullptr);
   return change;
 }
 
+// Ends BB with a call to Version, passing on the arguments of F, and
+// returns its result.
+static void createForwardingCall(Function &F, Function *Version, BasicBlock *BB) {
+  vector<Value *> Args;
+  for (Function::arg_iterator A = F.arg_begin(), AE = F.arg_end(); A != AE; ++A) {
+    Args.push_back(&*A);
+  }
+
+  CallInst *Call = CallInst::Create(Version, Args, "", BB);
+  if (F.getReturnType()->isVoidTy()) {
+    ReturnInst::Create(F.getContext(), BB);
+  } else {
+    ReturnInst::Create(F.getContext(), Call, BB);
+  }
+}
+
+bool SwoopDAE::versionOnRuntimeChecks(Function &F, Function *&Overlap, Function *&Disjoint) {
+  // Every getAnalysis on F recomputes all of its function analyses: get
+  // LoopAccessAnalysis first, so that the loops do not change afterwards.
+  LoopAccessAnalysis *LAA = &getAnalysis<LoopAccessAnalysis>(F);
+  LI = &getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+
+  vector<Loop *> Loops(LI->begin(), LI->end());
+  if (Loops.size() != 1 || !Loops.front()->getLoopPreheader()) {
+    return false;
+  }
+  Loop *L = Loops.front();
+
+  ValueToValueMap Strides;
+  const LoopAccessInfo &LAI = LAA->getInfo(L, Strides);
+  const RuntimePointerChecking *PtrChecking = LAI.getRuntimePointerChecking();
+  if (!LAI.canVectorizeMemory() || !PtrChecking->Need) {
+    return false;
+  }
+
+  BasicAAResult BAR(createLegacyPMBasicAAResult(*this, F));
+  AAResults AAR(createLegacyPMAAResults(*this, F, BAR));
+
+  // Every pair of a load and a store that may alias has to be covered by
+  // the checks. Must aliases are unaffected: they are not reused in either
+  // version.
+  list<LoadInst *> Loads;
+  list<StoreInst *> Stores;
+  for (Loop::block_iterator B = L->block_begin(), BE = L->block_end(); B != BE; ++B) {
+    for (BasicBlock::iterator I = (*B)->begin(), IE = (*B)->end(); I != IE; ++I) {
+      if (LoadInst *Load = dyn_cast<LoadInst>(&*I)) {
+        Loads.push_back(Load);
+      } else if (StoreInst *Store = dyn_cast<StoreInst>(&*I)) {
+        Stores.push_back(Store);
+      }
+    }
+  }
+
+  unsigned MayAliasPairs = 0;
+  for (LoadInst *Load : Loads) {
+    for (StoreInst *Store : Stores) {
+      if (instructionAlias(&AAR, Store, Load) != AliasResult::MayAlias) {
+        continue;
+      }
+
+      if (!isCheckedAtRuntime(PtrChecking, Load->getPointerOperand(),
+                              Store->getPointerOperand())) {
+        return false;
+      }
+      ++MayAliasPairs;
+    }
+  }
+
+  if (MayAliasPairs == 0) {
+    return false;
+  }
+
+  errs() << MayAliasPairs << " may-alias pair(s), "
+         << LAI.getNumRuntimePointerChecks() << " runtime check(s).\n";
+
+  // Both versions are cloned before F is turned into the dispatcher
+  Overlap = cloneFunction(&F);
+  Overlap->setName(F.getName() + ".overlap");
+  Disjoint = cloneFunction(&F);
+  Disjoint->setName(F.getName() + ".disjoint");
+
+  BasicBlock *Preheader = L->getLoopPreheader();
+  Instruction *Conflict = LAI.addRuntimeChecks(Preheader->getTerminator()).second;
+
+  LLVMContext &Context = F.getContext();
+  BasicBlock *OverlapBB = BasicBlock::Create(Context, "rtcheck.overlap", &F);
+  BasicBlock *DisjointBB = BasicBlock::Create(Context, "rtcheck.disjoint", &F);
+  createForwardingCall(F, Overlap, OverlapBB);
+  createForwardingCall(F, Disjoint, DisjointBB);
+
+  TerminatorInst *TI = Preheader->getTerminator();
+  BranchInst::Create(OverlapBB, DisjointBB, Conflict, TI);
+  TI->eraseFromParent();
+
+  // The loop itself is now unreachable in F
+  removeUnreachableBlocks(F);
+  return true;
+}
+
 bool SwoopDAE::isSwoopKernel(Function &F) {
   return F.getName().str().find(F_KERNEL_SUBSTR) != string::npos &&
       F.getName().str().find(CLONE_SUFFIX) == string::npos;
@@ -158,7 +342,7 @@ void SwoopDAE::divideLoads(list<LoadInst *> &toHoist,
     set<Instruction *> Deps;
     getRequirementsInIteration(AA, LI, *P, Deps);
 
-    LCDResult DepLCD = getLCDUnion(AA, LI, Deps);
+    LCDResult DepLCD = getLCDUnion(AA, LI, Deps, UnrollCount);
     LCDResult Res = getLCDInfo(AA, LI, *P, UnrollCount);
 
     if (DepLCD == LCDResult::NoLCD && Res == LCDResult::NoLCD) {
@@ -280,6 +464,10 @@ void SwoopDAE::identifyPhaseLoads(list<LoadInst *> &toHoist,
   if (Remaining.empty()) {
     // All elements are required for the CFG, in this case
     // there is no meaning to do multiaccess
+    if (AccessPhases.empty()) {
+      // No loads, only intrinsics to prefetch: still one access phase
+      AccessPhases.push_back(new set<LoadInst *>());
+    }
     return;
   }
 
@@ -292,53 +480,186 @@ void SwoopDAE::identifyPhaseLoads(list<LoadInst *> &toHoist,
     return;
   }
 
-  // For each load, find the set of other loads in toHoist that it
-  // depends on
-  map<Instruction *, set<Instruction *> *> LoadDeps;
+  // Split into access phases: an access phase should be created
+  // such that there are no dependencies between loads within the phase.
+  // Grouping the loads by their depth in the dependency DAG of the
+  // remaining loads puts every load in the first phase after all the
+  // loads it depends on.
+  set<LoadInst *> RemainingLoads;
   for (auto L = Remaining.begin(), LE = Remaining.end(); L != LE; ++L) {
-    set<Instruction *> Deps;
-    getRequirementsInIteration(AA, LI, *L, Deps);
-    set<Instruction *> *RelevantDeps = new set<Instruction *>();
-
-    // find the relevant requirements / deps: the ones that
-    // are loads themselves
-    set_intersection(Deps.begin(), Deps.end(), Remaining.begin(),
-                     Remaining.end(),
-                     inserter(*RelevantDeps, RelevantDeps->begin()));
-    LoadDeps[*L] = RelevantDeps;
+    RemainingLoads.insert((LoadInst *)*L);
   }
 
-  // Split into access phases: an access phase should be created
-  // such that there are no dependencies between loads within the phase.
-  while (!Remaining.empty()) {
-    AccessPhase = new set<LoadInst *>();
-    // Contains all loads that do not have dependencies in the remaining
-    // set of loads
-    for (auto L = Remaining.begin(), LE = Remaining.end(); L != LE; ++L) {
-      set<Instruction *> &AllDeps = *(LoadDeps[*L]);
-      set<Instruction *> RemainingDeps;
-      set_intersection(Remaining.begin(), Remaining.end(), AllDeps.begin(),
-                       AllDeps.end(),
-                       inserter(RemainingDeps, RemainingDeps.begin()));
-      if (RemainingDeps.empty()) {
-        // No dependencies remain that are not already hoisted.
-        // Safely insert this load to this access phase.
-        AccessPhase->insert((LoadInst *)*L);
-      }
+  IndirectionDepth Depth(AA, LI);
+  Depth.analyze(RemainingLoads);
+
+  vector<set<LoadInst *>> Levels;
+  Depth.getLevels(Levels);
+  for (set<LoadInst *> &Level : Levels) {
+    if (!Level.empty()) {
+      AccessPhases.push_back(new set<LoadInst *>(Level));
     }
+  }
+}
 
-    // Remove all loads from the current access phase
-    for (auto L = AccessPhase->begin(), LE = AccessPhase->end(); L != LE; ++L) {
-      Remaining.erase(*L);
+// The kernel loop is the outermost loop of its function
+static bool isInInnerLoop(LoopInfo *LI, Instruction *I) {
+  Loop *L = LI->getLoopFor(I->getParent());
+  return L && L->getParentLoop();
+}
+
+// Returns true if Load can be executed at InsertPt without faulting and
+// without reading a different value. The access phase only writes local
+// memory, so loads of visible memory cannot be clobbered by hoisting them.
+static bool isSafeToHoistLoad(LoadInst *Load, Instruction *InsertPt, DominatorTree &DT) {
+  if (!Load->isSimple() || isLocalPointer(Load->getPointerOperand())) {
+    return false;
+  }
+
+  if (isSafeToSpeculativelyExecute(Load, InsertPt, &DT)) {
+    return true;
+  }
+
+  const DataLayout &DL = Load->getModule()->getDataLayout();
+  unsigned Align = Load->getAlignment();
+  if (!Align) {
+    Align = DL.getABITypeAlignment(Load->getType());
+  }
+  return isSafeToLoadUnconditionally(Load->getPointerOperand(), InsertPt, Align);
+}
+
+// Adds the instructions that have to be moved to compute V at InsertPt to
+// Slice, operands first. Returns false if one of them cannot be moved.
+static bool collectHoistable(Value *V, Instruction *InsertPt, Loop *L, LoopInfo &LI,
+                             DominatorTree &DT, SetVector<Instruction *> &Slice) {
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I || Slice.count(I) || DT.dominates(I, InsertPt)) {
+    return true;
+  }
+
+  // Values of other iterations or inner loops cannot be computed earlier
+  if (isa<PHINode>(I) || LI.getLoopFor(I->getParent()) != L) {
+    return false;
+  }
+
+  if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+    if (!isSafeToHoistLoad(Load, InsertPt, DT)) {
+      return false;
     }
+  } else if (!isSafeToSpeculativelyExecute(I)) {
+    return false;
+  }
 
-    AccessPhases.push_back(AccessPhase);
+  for (Value *Op : I->operands()) {
+    if (!collectHoistable(Op, InsertPt, L, LI, DT, Slice)) {
+      return false;
+    }
   }
+  Slice.insert(I);
+  return true;
+}
 
-  // Free resources
-  for (auto D = LoadDeps.begin(), DE = LoadDeps.end(); D != DE; ++D) {
-    delete (D->second);
+static bool isPrefetch(Instruction *I) {
+  IntrinsicInst *Intr = dyn_cast<IntrinsicInst>(I);
+  return Intr && Intr->getIntrinsicID() == Intrinsic::prefetch;
+}
+
+static void insertPrefetchAt(Value *DataPtr, Instruction *InsertPt) {
+  Module *M = InsertPt->getModule();
+  LLVMContext &Context = M->getContext();
+  Type *I8Ptr = Type::getInt8PtrTy(Context, DataPtr->getType()->getPointerAddressSpace());
+  Type *I32 = Type::getInt32Ty(Context);
+
+  IRBuilder<> Builder(InsertPt);
+  Value *Cast = Builder.CreatePointerCast(DataPtr, I8Ptr);
+  Value *PrefFun = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
+  Builder.CreateCall(PrefFun, {Cast, ConstantInt::get(I32, 0),                       // read
+                               ConstantInt::get(I32, 3), ConstantInt::get(I32, 1)}); // data
+}
+
+// Moves the loads and prefetches of Access that are executed conditionally
+// within an iteration to the loop header, together with their address
+// computation. A load that might fault there stays in place, but its address
+// is prefetched from the header instead. Once emptied, the branches are
+// removed by simplifying the CFG, leaving mostly straight-line access code
+// whose misses can all be in flight at the same time.
+// Returns true if anything was moved.
+static bool hoistConditionalAccesses(Function &Access) {
+  DominatorTree DT(Access);
+  LoopInfo LI(DT);
+  bool Changed = false;
+
+  for (Loop *L : LI) {
+    BasicBlock *Latch = L->getLoopLatch();
+    if (!Latch) {
+      continue;
+    }
+    Instruction *InsertPt = L->getHeader()->getTerminator();
+
+    // Accesses in blocks that are not executed in every iteration
+    vector<Instruction *> Candidates;
+    for (BasicBlock *BB : L->blocks()) {
+      if (DT.dominates(BB, Latch) || LI.getLoopFor(BB) != L) {
+        continue;
+      }
+      for (Instruction &I : *BB) {
+        if (isa<LoadInst>(&I) || isPrefetch(&I)) {
+          Candidates.push_back(&I);
+        }
+      }
+    }
+
+    for (Instruction *I : Candidates) {
+      // Already moved as part of the address computation of another access
+      if (I->getParent() == L->getHeader()) {
+        continue;
+      }
+
+      SetVector<Instruction *> Slice;
+      LoadInst *Load = dyn_cast<LoadInst>(I);
+
+      if (Load && !isSafeToHoistLoad(Load, InsertPt, DT)) {
+        // Fall back to a prefetch, which never faults
+        if (isLocalPointer(Load->getPointerOperand()) ||
+            !collectHoistable(Load->getPointerOperand(), InsertPt, L, LI, DT, Slice)) {
+          continue;
+        }
+        for (Instruction *S : Slice) {
+          S->moveBefore(InsertPt);
+        }
+        insertPrefetchAt(Load->getPointerOperand(), InsertPt);
+        Changed = true;
+        continue;
+      }
+
+      bool Hoistable = true;
+      for (Value *Op : I->operands()) {
+        Hoistable &= collectHoistable(Op, InsertPt, L, LI, DT, Slice);
+      }
+      if (!Hoistable) {
+        continue;
+      }
+
+      for (Instruction *S : Slice) {
+        S->moveBefore(InsertPt);
+      }
+      I->moveBefore(InsertPt);
+
+      // The pseudo use of a reused load only keeps it alive; let it follow
+      // so that it does not keep the branch alive
+      if (Load) {
+        for (User *U : Load->users()) {
+          Instruction *UI = cast<Instruction>(U);
+          if (InstrhasMetadata(UI, SWOOPTYPE_TAG, "ReuseHelper")) {
+            UI->moveBefore(InsertPt);
+          }
+        }
+      }
+      Changed = true;
+    }
   }
+
+  return Changed;
 }
 
 bool SwoopDAE::createAccessPhase(Phase &P, bool isMain) {
@@ -388,6 +709,9 @@ bool SwoopDAE::createAccessPhase(Phase &P, bool isMain) {
   }
 
   int prefs = insertPrefetches(P.ToPref, toKeep, true);
+  if (isMain) {
+    prefs += insertIntrinsicPrefetches(Access, toKeep);
+  }
   int reuse = insertReuse(P.ToReuse, toKeep);
   int loads = insertReuse(P.ToLoad, toKeep);
 
@@ -413,6 +737,11 @@ bool SwoopDAE::createAccessPhase(Phase &P, bool isMain) {
   TargetTransformInfo &TTI =
       getAnalysis<TargetTransformInfoWrapperPass>().getTTI(Access);
   simplifyCFG(&Access, TTI);
+
+  // If-convert the access phase as far as this is fault-safe
+  if (SpeculateAccess && hoistConditionalAccesses(Access)) {
+    simplifyCFG(&Access, TTI);
+  }
   return true;
 }
 
@@ -424,7 +753,21 @@ void SwoopDAE::initAccessPhases(Function &F,
   list<LoadInst *> toReuse; // LoadInsts to reuse
   list<LoadInst *> toLoad;  // LoadInsts to load in A and re-load in E
   list<LoadInst *> toPref;  // LoadInsts to prefetch
-  divideLoads(toHoist, toPref, toReuse, toLoad, UnrollCount);
+  divideLoads(toHoist, toPref, toReuse, toLoad, KernelUnroll);
+
+  // Loads of an inner loop cannot be reused, prefetch them instead so that
+  // the inner loop of the access phase does not stall on them
+  LoopInfo &KernelLI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+  for (list<LoadInst *> *Loads : {&toReuse, &toLoad}) {
+    for (auto I = Loads->begin(); I != Loads->end();) {
+      if (isInInnerLoop(&KernelLI, *I)) {
+        toPref.push_back(*I);
+        I = Loads->erase(I);
+      } else {
+        ++I;
+      }
+    }
+  }
 
   // Identify the loads for each access phase
   vector<set<LoadInst *> *> AccessPhaseLoads;
@@ -447,6 +790,7 @@ void SwoopDAE::initAccessPhases(Function &F,
     } else {
       // All other access phases are created by cloning
       P->F = cloneFunction(AccessPhases[i - 1]->F, P->VMap);
+      mapLCDInfo(P->VMap);
 
       if (mergeBranches) {
         minimizeFunctionFromBranchPred(&getAnalysis<LoopInfoWrapperPass>(*(P->F)).getLoopInfo(),
@@ -513,7 +857,7 @@ bool SwoopDAE::updateSucceedingAccessMaps(Phase &P,
   }
 }
 
-bool SwoopDAE::isWorthTransforming(Function &F, list<LoadInst*> &Loads) {
+bool SwoopDAE::isWorthTransforming(Function &F, list<LoadInst*> &Loads, unsigned Intrinsics) {
   std::vector<Loop *> Loops(LI->begin(), LI->end());
   assert(Loops.size() == 1 && "After modification we should only have one loop!");
 
@@ -536,16 +880,63 @@ bool SwoopDAE::isWorthTransforming(Function &F, list<LoadInst*> &Loads) {
     }
   }
 
-  errs() << "Heuristic: " << Loads.size() << " Loads, " << branchCount << " Branches.\n";
-  if (Loads.size() / (double) branchCount < 0.5) {
+  errs() << "Heuristic: " << Loads.size() << " Loads, " << Intrinsics << " Intrinsics, "
+         << branchCount << " Branches.\n";
+  if ((Loads.size() + Intrinsics) / (double) branchCount < 0.5) {
     return false;
   }
 
   return true;
 }
 
+bool SwoopDAE::readKernelHints(Function &F) {
+  LoopInfo &KernelLI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+  ClairvoyanceHints Hints;
+  for (Loop *L : KernelLI) {
+    getClairvoyanceHints(L, Hints);
+  }
+
+  KernelUnroll = Hints.HasUnroll ? Hints.Unroll : (unsigned)UnrollCount;
+
+  // -unroll=auto without a hint: ForcedLoopUnroll did not see this loop
+  if (KernelUnroll == UnrollAuto) {
+    KernelUnroll = 1;
+  }
+
+  // Outer loops are not unrolled (see ForcedLoopUnroll)
+  for (Loop *L : KernelLI) {
+    if (!L->empty()) {
+      KernelUnroll = 1;
+    }
+  }
+  KernelIndir = Hints.HasIndir ? Hints.Indir : (unsigned)IndirThresh;
+
+  if (!Hints.Type.empty() && !SwoopType.empty() && Hints.Type != SwoopType) {
+    errs() << "Skipped: loop is tuned for swoop type " << Hints.Type << "\n";
+    return false;
+  }
+  return true;
+}
+
 bool SwoopDAE::swoopify(Function &F) {
+  if (!readKernelHints(F)) {
+    return false;
+  }
+
+  if (ScalarReplace) {
+    scalarReplace(F);
+  }
+
   LI = &getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+
+  // Record the LCD information before any phase is cloned from F: querying
+  // an analysis of a clone recomputes all function analyses for the clone.
+  if (isLCDDisambiguationEnabled()) {
+    LoopCarriedDependencyAnalysis &LCDAnalysis =
+        getAnalysis<LoopCarriedDependencyAnalysisWrapperPass>(F).getLCDAnalysis();
+    recordLCDInfo(LCDAnalysis, LI, F);
+  }
+
   DT = &getAnalysis<DominatorTreeWrapperPass>(F).getDomTree();
   PDT = &getAnalysis<PostDominatorTree>(F);
 
@@ -559,21 +950,39 @@ bool SwoopDAE::swoopify(Function &F) {
   AA = &AAR;
 
   list<LoadInst *> Loads, toHoist;   // LoadInsts to hoist
-  findAccessInsts(AA, LI, F, Loads, HoistDelinquent, IndirThresh);
+  findAccessInsts(AA, LI, F, Loads, HoistDelinquent, KernelIndir);
+
+  if (swoopifyTraversal(F, Loads)) {
+    return true;
+  }
 
   // filter loads on LCDS (data & control dependencies)
-  filterLoadsOnLCD(AA, LI, Loads, toHoist, UnrollCount);
+  filterLoadsOnLCD(AA, LI, Loads, toHoist, KernelUnroll);
   unsigned int BadLCDDeps = Loads.size() - toHoist.size();
 
-  errs() << "Indir: " << IndirThresh << ", " << toHoist.size() << " load(s) in access phase.\n";
+  errs() << "Indir: " << KernelIndir << ", " << toHoist.size() << " load(s) in access phase.\n";
   errs() << "(BadLCDDeps: " << BadLCDDeps << ")\n";
 
-  if (!isWorthTransforming(F, toHoist)) {
+  // Gathers, masked loads and memory copies are only prefetched in the
+  // access phase, tag the ones it can compute the address of
+  list<IntrinsicInst *> Intrinsics;
+  findAccessIntrinsicInsts(AA, LI, F, Intrinsics, HoistDelinquent, KernelIndir);
+  unsigned int PrefIntrinsics = 0;
+  for (IntrinsicInst *I : Intrinsics) {
+    set<Instruction *> Deps;
+    getRequirementsInIteration(AA, LI, I, Deps);
+    if (expectAtLeast(AA, LI, Deps, LCDResult::NoLCD, KernelUnroll)) {
+      AttachMetadata(I, SWOOPTYPE_TAG, "Prefetch");
+      ++PrefIntrinsics;
+    }
+  }
+
+  if (!isWorthTransforming(F, toHoist, PrefIntrinsics)) {
     errs() << "Transformation not suitable for this loop.\n";
     return false;
   }
 
-  if (toHoist.empty()) {
+  if (toHoist.empty() && PrefIntrinsics == 0) {
     errs() << "Disqualified: no loads to hoist\n";
     return false;
   }
@@ -582,6 +991,19 @@ bool SwoopDAE::swoopify(Function &F) {
   return succeeded;
 }
 
+void SwoopDAE::scalarReplace(Function &F) {
+  // Every getAnalysis on F recomputes all of its function analyses, and
+  // scalar evolution is recreated rather than updated: get it last.
+  LI = &getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+  DT = &getAnalysis<DominatorTreeWrapperPass>(F).getDomTree();
+  ScalarEvolution *SE = &getAnalysis<ScalarEvolutionWrapperPass>(F).getSE();
+
+  BasicAAResult BAR(createLegacyPMBasicAAResult(*this, F));
+  AAResults AAR(createLegacyPMAAResults(*this, F, BAR));
+
+  replaceLoadsWithDistance(&AAR, LI, DT, SE, F);
+}
+
 AllocaInst *initBranchCheckVar(Function *access) {
   IRBuilder<> Builder(&*(access->getEntryBlock().getTerminator()->getSuccessor(0)->getFirstInsertionPt()));
   AllocaInst *bc = Builder.CreateAlloca(Type::getInt1Ty(getGlobalContext()), 0, "branch_flag");
@@ -591,6 +1013,97 @@ AllocaInst *initBranchCheckVar(Function *access) {
   return bc;
 }
 
+// Returns true for the label and marker inline assembly that stitching
+// inserts into the loop. They clobber memory only to stay in place.
+static bool isPhaseMarker(Instruction *I) {
+  CallInst *Call = dyn_cast<CallInst>(I);
+  return Call && isa<InlineAsm>(Call->getCalledValue()) && Call->getNumArgOperands() == 0;
+}
+
+// Returns true if I is executed whenever L is entered
+static bool isGuaranteedToExecute(Instruction *I, Loop *L, DominatorTree &DT) {
+  SmallVector<BasicBlock *, 8> ExitBlocks;
+  L->getExitBlocks(ExitBlocks);
+  for (BasicBlock *Exit : ExitBlocks) {
+    if (!DT.dominates(I->getParent(), Exit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Moves the instructions of the stitched loops of F whose operands are loop
+// invariant to the preheader: address computations, and loads that no
+// instruction in the loop may write to, e.g. the fields of the aggregated
+// kernel arguments that each phase reloads. Returns the number of moved
+// instructions.
+static unsigned hoistLoopInvariants(Function &F, LoopInfo &LI, DominatorTree &DT, AliasAnalysis *AA) {
+  unsigned Hoisted = 0;
+
+  for (Loop *L : LI) {
+    BasicBlock *Preheader = L->getLoopPreheader();
+    if (!Preheader) {
+      continue;
+    }
+    Instruction *InsertPt = Preheader->getTerminator();
+
+    vector<Instruction *> Writers;
+    bool MayThrow = false;
+    for (BasicBlock *BB : L->blocks()) {
+      for (Instruction &I : *BB) {
+        if (isPhaseMarker(&I)) {
+          continue;
+        }
+        if (I.mayWriteToMemory()) {
+          Writers.push_back(&I);
+        }
+        MayThrow |= I.mayThrow();
+      }
+    }
+
+    // Dominator order, so that operands are hoisted before their users
+    for (auto Node : depth_first(DT.getNode(L->getHeader()))) {
+      BasicBlock *BB = Node->getBlock();
+      if (!L->contains(BB)) {
+        continue;
+      }
+
+      for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;) {
+        Instruction *I = &*II++;
+        if (isa<PHINode>(I) || isa<TerminatorInst>(I) || !L->hasLoopInvariantOperands(I)) {
+          continue;
+        }
+
+        if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+          if (!Load->isSimple()) {
+            continue;
+          }
+
+          MemoryLocation Loc = MemoryLocation::get(Load);
+          bool Written = any_of(Writers.begin(), Writers.end(), [&](Instruction *W) {
+            return AA->getModRefInfo(W, Loc) & MRI_Mod;
+          });
+          if (Written) {
+            continue;
+          }
+
+          if (!isSafeToSpeculativelyExecute(Load, InsertPt, &DT) &&
+              (MayThrow || !isGuaranteedToExecute(Load, L, DT))) {
+            continue;
+          }
+        } else if (I->mayReadOrWriteMemory() || !isSafeToSpeculativelyExecute(I)) {
+          continue;
+        }
+
+        I->moveBefore(InsertPt);
+        ++Hoisted;
+      }
+    }
+  }
+
+  return Hoisted;
+}
+
 bool SwoopDAE::swoopifyCore(Function &F, list<LoadInst*> toHoist) {
   AllocaInst *branch_cond = initBranchCheckVar(&F);
 
@@ -605,6 +1118,7 @@ bool SwoopDAE::swoopifyCore(Function &F, list<LoadInst*> toHoist) {
 
   if (OptimizeBranches) {
     FAlternative = cloneFunction(&F, VMap);
+    mapLCDInfo(VMap);
     for (LoadInst *L : toHoist) {
       toHoistMapped.push_back(dyn_cast<LoadInst>(VMap[L]));
     }
@@ -663,6 +1177,13 @@ bool SwoopDAE::swoopifyCore(Function &F, list<LoadInst*> toHoist) {
   // insert phi nodes wherever a value is not defined for all predecessors
   ensureStrictSSA(*(MainPhase->F), *LI, *DT, PhaseRoots);
 
+  // Every phase recomputes the invariant values it needs; compute them once
+  // before the loop instead
+  if (HoistInvariants) {
+    unsigned Hoisted = hoistLoopInvariants(*(MainPhase->F), *LI, *DT, AA);
+    errs() << "Hoisted " << Hoisted << " loop invariant instruction(s).\n";
+  }
+
   delete(MainPhase);
 
   return true;
@@ -679,6 +1200,7 @@ Phase* SwoopDAE::createAccessExecuteFunction(Function &F, list<LoadInst *, alloc
   // Execute phase initialization
   Phase ExecutePhase;
   ExecutePhase.F = cloneFunction(AccessPhases[AccessPhases.size() - 1]->F, ExecutePhase.VMap);
+  mapLCDInfo(ExecutePhase.VMap);
 
   LI = &getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
   DT->recalculate(F);
@@ -790,6 +1312,10 @@ Phase * SwoopDAE::createAccessPhases(vector<Phase *> &AccessPhases,
   return FirstAccessPhase;
 }
 
+bool SwoopDAE::swoopifyTraversal(Function &F, list<LoadInst *> &Loads) {
+  return false;
+}
+
 LCDResult SwoopDAE::acceptedForReuse() {
   return LCDResult::NoLCD;
 }
@@ -865,7 +1391,13 @@ void SwoopDAE::selectInstructionsToReuseWithinAccess(Function *F, set<Instructio
     getRequirementsInIteration(AA, LI, Candidate, Deps);
     Deps.insert(Candidate);
 
-    if (expectAtLeast(AA, LI, Deps, MinLCDRequirement)) {
+    // A value computed in an inner loop only survives from its last
+    // iteration, reusing it would be wrong for all other iterations
+    if (any_of(Deps, [this](Instruction *I) { return isInInnerLoop(LI, I); })) {
+      continue;
+    }
+
+    if (expectAtLeast(AA, LI, Deps, MinLCDRequirement, KernelUnroll)) {
       for (Instruction *Dependency : Deps) {
         if (IsReuseInstruction(Dependency, ReuseAll, ReuseBranchCondition)) {
           if (toKeep->insert(Dependency).second) {
@@ -1010,6 +1542,26 @@ void SwoopDAE::removeListed(Function &F, set<Instruction *> &toRemove,
   }
 }
 
+int SwoopDAE::insertIntrinsicPrefetches(Function &F, set<Instruction *> &toKeep) {
+  list<IntrinsicInst *> toPref;
+  for (auto I = inst_begin(F), IE = inst_end(F); I != IE; ++I) {
+    if (InstrhasMetadataKind(&*I, SWOOPTYPE_TAG) && "Prefetch" == getInstructionMD(&*I, SWOOPTYPE_TAG)) {
+      toPref.push_back(cast<IntrinsicInst>(&*I));
+    }
+  }
+
+  // Indirections are already filtered in findAccessIntrinsicInsts, see
+  // insertPrefetches
+  unsigned MaxIndirThresh = 100;
+  int count = 0;
+  for (IntrinsicInst *I : toPref) {
+    if (insertIntrinsicPrefetch(AA, I, toKeep, MaxIndirThresh, CacheLineSize, CopyPrefetchLines) == Inserted) {
+      ++count;
+    }
+  }
+  return count;
+}
+
 void SwoopDAE::filterLoadsOnLCD(AliasAnalysis *AA,
                                 LoopInfo *LI,
                                 list<LoadInst *> &Loads,
@@ -1021,7 +1573,7 @@ void SwoopDAE::filterLoadsOnLCD(AliasAnalysis *AA,
     set<Instruction *> Deps;
     getRequirementsInIteration(AA, LI, *L, Deps);
 
-    bool depsNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::NoLCD);
+    bool depsNoLCD = expectAtLeast(AA, LI, Deps, LCDResult::NoLCD, UnrollCount);
     if (depsNoLCD && getLCDInfo(AA, LI, *L, UnrollCount) < LCDResult::MustLCD) {
       FilteredLoads.push_back(*L);
     }
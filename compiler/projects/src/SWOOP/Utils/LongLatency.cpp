@@ -26,12 +26,12 @@
 using namespace util;
 
 // Instructions are marked as Long Latency I with metadata information
-bool isLongLatency(Instruction *I) {
+inline bool isLongLatency(Instruction *I) {
   return InstrhasMetadata(I, "Latency", "Long");
 }
 
 // Adds pointer to all long latency LoadInsts in F to LoadList.
-void findDelinquentLoads(Function &F, list<LoadInst *> &LoadList) {
+inline void findDelinquentLoads(Function &F, list<LoadInst *> &LoadList) {
   for (inst_iterator iI = inst_begin(F), iE = inst_end(F); iI != iE; ++iI) {
     if (LoadInst::classof(&(*iI)) && isLongLatency(&(*iI))) {
       LoadList.push_back((LoadInst *)&(*iI));
@@ -0,0 +1,101 @@
+//===------------ LoopProfile.cpp - Sampled profile of loops --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file LoopProfile.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Implementation of LoopProfile.h
+//===----------------------------------------------------------------------===//
+#include "LoopProfile.h"
+
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <fstream>
+#include <set>
+#include <sstream>
+
+bool LoopProfile::read(const std::string &Path) {
+  std::ifstream In(Path.c_str());
+  if (!In) {
+    errs() << "Cannot read loop profile " << Path << "\n";
+    return false;
+  }
+
+  std::string Line;
+  unsigned LineNo = 0;
+  while (std::getline(In, Line)) {
+    ++LineNo;
+    if (Line.empty() || Line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream Fields(Line);
+    std::string Location;
+    Sample S;
+    size_t Colon;
+    unsigned SourceLine;
+    if (!(Fields >> Location >> S.Cycles >> S.Misses) ||
+        (Colon = Location.rfind(':')) == std::string::npos ||
+        !(std::istringstream(Location.substr(Colon + 1)) >> SourceLine)) {
+      errs() << Path << ":" << LineNo << ": ignoring malformed line\n";
+      continue;
+    }
+
+    LineKey Key(sys::path::filename(Location.substr(0, Colon)).str(), SourceLine);
+    Sample &Acc = Lines[Key];
+    Acc.Cycles += S.Cycles;
+    Acc.Misses += S.Misses;
+  }
+  return true;
+}
+
+bool LoopProfile::getLineKey(const Instruction *I, LineKey &Key) {
+  const DebugLoc &Loc = I->getDebugLoc();
+  if (!Loc) {
+    return false;
+  }
+
+  Key = LineKey(sys::path::filename(Loc.get()->getFilename()).str(), Loc.getLine());
+  return true;
+}
+
+double LoopProfile::getTimeShare(const Loop *L) const {
+  // Count each line once, however many instructions it has
+  std::set<LineKey> Seen;
+  double Share = 0;
+  for (BasicBlock *BB : L->blocks()) {
+    for (Instruction &I : *BB) {
+      LineKey Key;
+      if (!getLineKey(&I, Key) || !Seen.insert(Key).second) {
+        continue;
+      }
+
+      auto S = Lines.find(Key);
+      if (S != Lines.end()) {
+        Share += S->second.Cycles;
+      }
+    }
+  }
+  return Share;
+}
+
+double LoopProfile::getMissShare(const Instruction *I) const {
+  LineKey Key;
+  if (!getLineKey(I, Key)) {
+    return 0;
+  }
+
+  auto S = Lines.find(Key);
+  return S == Lines.end() ? 0 : S->second.Misses;
+}
@@ -0,0 +1,66 @@
+//===--------------------------- LoopProfile.h ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file LoopProfile.h
+///
+/// \brief Sampled profile mapped to loops and loads via debug locations
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+// A profile holds, per source line, the share of all sampled cycles and the
+// share of all sampled cache misses attributed to it, one line each:
+//
+//   # file:line cycles misses
+//   mcf.c:412 0.312 0.540
+//   mcf.c:413 0.041 0.002
+//
+// experiments/swoop/scripts/loop_profile.py writes such a file from perf
+// data. The time share of a loop is the sum of the cycle shares of the
+// lines of its instructions, the miss share of a load the one of its line.
+// Files are matched on their base name, the code must be compiled with -g.
+//
+//===----------------------------------------------------------------------===//
+#ifndef PROJECT_LOOPPROFILE_H
+#define PROJECT_LOOPPROFILE_H
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Instruction.h"
+
+#include <map>
+#include <string>
+#include <utility>
+
+using namespace llvm;
+
+class LoopProfile {
+public:
+  // Reads the profile in Path. Returns false if it cannot be read.
+  bool read(const std::string &Path);
+
+  bool empty() const { return Lines.empty(); }
+
+  // Share of the sampled cycles spent in L, including its inner loops
+  double getTimeShare(const Loop *L) const;
+
+  // Share of the sampled cache misses at the line of I
+  double getMissShare(const Instruction *I) const;
+
+private:
+  struct Sample {
+    double Cycles;
+    double Misses;
+  };
+
+  typedef std::pair<std::string, unsigned> LineKey;
+  std::map<LineKey, Sample> Lines;
+
+  static bool getLineKey(const Instruction *I, LineKey &Key);
+};
+
+#endif //PROJECT_LOOPPROFILE_H
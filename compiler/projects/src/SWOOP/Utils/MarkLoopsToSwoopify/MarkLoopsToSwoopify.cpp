@@ -18,22 +18,110 @@
 //
 //===----------------------------------------------------------------------===//
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/IntrinsicInst.h"
 
 #include "../../../DAE/Utils/SkelUtils/Utils.cpp"
+#include "LoopProfile.h"
+#include "Util/Analysis/OpenMPLoops.h"
+#include "Util/Pipeline/SharedOptions.h"
 
 #define KERNEL_MARKING "__kernel__"
 
 using namespace llvm;
 
-static cl::opt<std::string> BenchName("bench-name",
-                                      cl::desc("The benchmark name"),
-                                      cl::value_desc("name"));
-
 static cl::opt<bool> RequireDelinquent(
     "require-delinquent",
-    cl::desc("Loop has to contain delinquent loads to be marked"),
+    cl::desc("Loop selected by a clairvoyance hint has to contain "
+             "delinquent loads to be marked"),
     cl::init(true));
 
+// Marks hinted loops around inner-most loops instead of the inner-most
+// loops, so that the access phase runs ahead by a whole inner loop
+static cl::opt<bool> OuterLoops(
+    "outer-loops",
+    cl::desc("Mark loops with a clairvoyance.enable hint around inner-most loops"),
+    cl::init(false));
+
+// Selects the loops to mark from a sampled profile instead of loop hints
+static cl::opt<std::string> ProfileFile(
+    "loop-profile",
+    cl::desc("Mark the hot innermost loops of this profile (see LoopProfile.h)"),
+    cl::value_desc("filename"));
+
+static cl::opt<double> HotLoopThreshold(
+    "hot-loop-threshold",
+    cl::desc("Min share of the sampled cycles for a profiled loop to be marked"),
+    cl::init(0.05));
+
+static cl::opt<double> MissThreshold(
+    "miss-threshold",
+    cl::desc("Min share of the sampled cache misses for a load to be delinquent"),
+    cl::init(0.01));
+
+// Selects the chunk loops of statically scheduled OpenMP worksharing loops
+// in outlined parallel regions, see OpenMPLoops.h
+static cl::opt<bool> OpenMPLoops(
+    "omp-loops",
+    cl::desc("Mark the chunk loops of statically scheduled OpenMP loops"),
+    cl::init(false));
+
+// Source level marker of a loop, an assembly comment followed by its hints,
+// see experiments/swoop/sources/common/clairvoyance.h
+static const StringRef MarkerPrefix = "# clairvoyance";
+
+static InlineAsm *getMarker(Instruction *I) {
+  CallInst *CI = dyn_cast<CallInst>(I);
+  InlineAsm *IA = CI ? dyn_cast<InlineAsm>(CI->getCalledValue()) : nullptr;
+  return IA && StringRef(IA->getAsmString()).startswith(MarkerPrefix) ? IA : nullptr;
+}
+
+// Reads the hints of a marker, e.g. "unroll=4 indir=2 type=spec". A marker
+// enables its loop unless it says enable=0. Returns false on unknown hints.
+static bool parseMarker(StringRef Text, util::ClairvoyanceHints &Hints) {
+  Hints.Enable = Hints.HasEnable = true;
+
+  SmallVector<StringRef, 4> Fields;
+  Text.split(Fields, " ", -1, false);
+  for (StringRef Field : Fields) {
+    std::pair<StringRef, StringRef> Hint = Field.split('=');
+    if (Hint.second.empty()) {
+      return false;
+    }
+    if (Hint.first == "type") {
+      Hints.Type = Hint.second.str();
+      continue;
+    }
+
+    unsigned Val;
+    if (Hint.second.getAsInteger(10, Val)) {
+      return false;
+    }
+    if (Hint.first == "enable") {
+      Hints.Enable = Val != 0;
+    } else if (Hint.first == "unroll") {
+      Hints.Unroll = Val;
+      Hints.HasUnroll = true;
+    } else if (Hint.first == "indir") {
+      Hints.Indir = Val;
+      Hints.HasIndir = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Loads, and the intrinsics the access phase prefetches for, can be delinquent
+static bool isMemoryRead(Instruction *I) {
+  if (isa<LoadInst>(I) || isa<MemTransferInst>(I)) {
+    return true;
+  }
+  IntrinsicInst *II = dyn_cast<IntrinsicInst>(I);
+  return II && (II->getIntrinsicID() == Intrinsic::masked_gather ||
+                II->getIntrinsicID() == Intrinsic::masked_load);
+}
+
 namespace {
 struct MarkLoopsToSwoopify : public FunctionPass {
 public:
@@ -45,24 +133,165 @@ public:
     AU.addRequired<DominatorTreeWrapperPass>();
   }
 
+  bool doInitialization(Module &M);
   bool runOnFunction(Function &F);
 
 private:
   unsigned loopCounter = 0;
+  LoopProfile Profile;
+
   bool markLoops(std::vector<Loop *> Loops, DominatorTree &DT);
+  bool selectMarkedLoops(Function &F, LoopInfo &LI);
+  bool selectProfiledLoops(LoopInfo &LI);
+  bool selectOpenMPLoops(Function &F, LoopInfo &LI, DominatorTree &DT);
 };
 }
 
+bool MarkLoopsToSwoopify::doInitialization(Module &M) {
+  if (!ProfileFile.empty()) {
+    Profile.read(ProfileFile);
+  }
+  return false;
+}
+
 bool MarkLoopsToSwoopify::runOnFunction(Function &F) {
-  if (!toBeDAE(&F)) {
+  // Copies imported from other modules (THINLTO in the Makefiles) are
+  // dropped at code generation, their loops are marked in their own module
+  if (F.hasAvailableExternallyLinkage()) {
     return false;
   }
 
   DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
   LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+
+  bool Selected = selectMarkedLoops(F, LI);
+  Selected |= !Profile.empty() && selectProfiledLoops(LI);
+  if (OpenMPLoops) {
+    // Read the chunk bounds of OpenMP loops once, so that the loops do not
+    // depend on memory the runtime wrote
+    Selected |= util::hoistChunkBoundLoads(F, LI) != 0;
+    Selected |= selectOpenMPLoops(F, LI, DT);
+  }
+
+  // Loops with a clairvoyance.enable hint are marked in any function
+  if (!toBeDAE(&F) && !util::hasClairvoyanceLoops(LI)) {
+    return Selected;
+  }
   std::vector<Loop *> Loops(LI.begin(), LI.end());
 
-  return markLoops(Loops, DT);
+  return markLoops(Loops, DT) || Selected;
+}
+
+// Turns the source level markers of F into hints on the innermost loop
+// around them, and removes them.
+bool MarkLoopsToSwoopify::selectMarkedLoops(Function &F, LoopInfo &LI) {
+  std::vector<Instruction *> Markers;
+  for (inst_iterator iI = inst_begin(F), iE = inst_end(F); iI != iE; ++iI) {
+    if (getMarker(&*iI)) {
+      Markers.push_back(&*iI);
+    }
+  }
+
+  for (Instruction *Marker : Markers) {
+    // Copies outside of the loop, e.g. in the guard of a rotated loop, are
+    // only dropped
+    if (Loop *L = LI.getLoopFor(Marker->getParent())) {
+      StringRef Text = StringRef(getMarker(Marker)->getAsmString())
+                           .substr(MarkerPrefix.size());
+      util::ClairvoyanceHints Hints;
+      util::getClairvoyanceHints(L, Hints);
+      if (parseMarker(Text, Hints)) {
+        util::setClairvoyanceHints(L, Hints);
+        errs() << "Marker: " << F.getName() << ":"
+               << L->getHeader()->getName() << Text << "\n";
+      } else {
+        errs() << "Ignoring malformed clairvoyance marker:" << Text << "\n";
+      }
+    }
+    Marker->eraseFromParent();
+  }
+  return !Markers.empty();
+}
+
+// Adds a clairvoyance.enable hint to the innermost loops that take at least
+// -hot-loop-threshold of the sampled cycles and contain a load with at least
+// -miss-threshold of the sampled misses. These loads are marked as long
+// latency. Loops with an explicit clairvoyance.enable hint are left as is.
+bool MarkLoopsToSwoopify::selectProfiledLoops(LoopInfo &LI) {
+  bool Selected = false;
+
+  std::vector<Loop *> Worklist(LI.begin(), LI.end());
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.back();
+    Worklist.pop_back();
+    if (!L->empty()) {
+      Worklist.insert(Worklist.end(), L->begin(), L->end());
+      continue;
+    }
+
+    util::ClairvoyanceHints Hints;
+    util::getClairvoyanceHintsInNest(L, Hints);
+    if (Hints.HasEnable) {
+      continue;
+    }
+
+    double TimeShare = Profile.getTimeShare(L);
+    if (TimeShare < HotLoopThreshold) {
+      continue;
+    }
+
+    std::vector<Instruction *> Delinquent;
+    for (BasicBlock *BB : L->blocks()) {
+      for (Instruction &I : *BB) {
+        if (isMemoryRead(&I) && Profile.getMissShare(&I) >= MissThreshold) {
+          Delinquent.push_back(&I);
+        }
+      }
+    }
+    if (Delinquent.empty()) {
+      continue;
+    }
+
+    for (Instruction *Read : Delinquent) {
+      if (!isLongLatency(Read)) {
+        AttachMetadata(Read, "Latency", "Long");
+      }
+    }
+
+    Hints.Enable = Hints.HasEnable = true;
+    util::setClairvoyanceHints(L, Hints);
+    Selected = true;
+
+    errs() << "Profile: " << L->getHeader()->getParent()->getName() << ":"
+           << L->getHeader()->getName() << " " << TimeShare << " of cycles, "
+           << Delinquent.size() << " delinquent read(s)\n";
+  }
+  return Selected;
+}
+
+// Adds a clairvoyance.enable hint to the chunk loops of F, unless they
+// already have one. A chunk loop around inner loops selects these, or itself
+// with -outer-loops, see loopToBeDAE.
+bool MarkLoopsToSwoopify::selectOpenMPLoops(Function &F, LoopInfo &LI, DominatorTree &DT) {
+  std::vector<Loop *> ChunkLoops;
+  util::findStaticChunkLoops(F, LI, DT, ChunkLoops);
+
+  bool Selected = false;
+  for (Loop *L : ChunkLoops) {
+    util::ClairvoyanceHints Hints;
+    util::getClairvoyanceHintsInNest(L, Hints);
+    if (Hints.HasEnable) {
+      continue;
+    }
+
+    Hints.Enable = Hints.HasEnable = true;
+    util::setClairvoyanceHints(L, Hints);
+    Selected = true;
+
+    errs() << "OpenMP: " << F.getName() << ":" << L->getHeader()->getName()
+           << " chunk loop\n";
+  }
+  return Selected;
 }
 
 bool MarkLoopsToSwoopify::markLoops(std::vector<Loop *> Loops,
@@ -71,12 +300,24 @@ bool MarkLoopsToSwoopify::markLoops(std::vector<Loop *> Loops,
 
   for (auto I = Loops.begin(), IE = Loops.end(); I != IE; ++I) {
     Loop *L = *I;
-    if (loopToBeDAE(L, BenchName, RequireDelinquent)) {
+    if (loopToBeDAE(L, BenchName, RequireDelinquent, OuterLoops)) {
+      // The marked loop is the one that gets extracted: keep the hints of
+      // its parents on it for the later stages
+      util::ClairvoyanceHints Hints;
+      if (util::getClairvoyanceHintsInNest(L, Hints)) {
+        util::setClairvoyanceHints(L, Hints);
+      }
+
       BasicBlock *H = L->getHeader();
       H->setName(Twine(KERNEL_MARKING + H->getParent()->getName().str() +
                        std::to_string(loopCounter)));
       loopCounter++;
       markedLoop = true;
+
+      // The inner loops of a marked outer loop are part of its kernel
+      if (!L->empty()) {
+        continue;
+      }
     }
 
     std::vector<Loop *> subLoops = L->getSubLoops();
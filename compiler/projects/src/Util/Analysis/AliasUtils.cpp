@@ -37,21 +37,22 @@ namespace util {
     Type *P2ElTy = cast<PointerType>(P2->getType())->getElementType();
     if (P2ElTy->isSized()) {
       P2Size = DL.getTypeStoreSize(P2ElTy);
-
-      return AA->alias(P1, P1Size, P2, P2Size);
     }
+
+    return AA->alias(P1, P1Size, P2, P2Size);
+  }
+
+  AliasResult instructionAlias(AliasAnalysis *AA, Instruction *I1, Instruction *I2) {
+    return AA->alias(MemoryLocation::get(I1), MemoryLocation::get(I2));
   }
 
   // Returns the closest alias between store and any of the LoadInsts
   // in toPref.
   AliasResult crossCheck(AliasAnalysis *AA, StoreInst *store, list<LoadInst *> &toPref) {
     AliasResult closest = AliasResult::NoAlias;
-    Value *storePointer = store->getPointerOperand();
     for (list<LoadInst *>::iterator I = toPref.begin(), E = toPref.end();
          I != E && closest != AliasResult::MustAlias; ++I) {
-      Value *loadPointer = (*I)->getPointerOperand();
-      switch (pointerAlias(AA, storePointer, loadPointer,
-                           (*I)->getModule()->getDataLayout())) {
+      switch (instructionAlias(AA, store, *I)) {
       case AliasResult::NoAlias:
         break; // Already default value.
       case AliasResult::MayAlias:
@@ -19,6 +19,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Util/Analysis/LoopCarriedDependencyAnalysis.h"
+#include "Util/Analysis/LAALCDAnalysis.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/DependenceAnalysis.h"
 #include "llvm/Analysis/LoopInfo.h"
@@ -29,6 +30,7 @@
 #include "llvm/IR/ValueMap.h"
 #include "llvm/Pass.h"
 #include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -42,6 +44,16 @@
 using namespace llvm;
 using namespace util;
 
+enum LCDAnalysisKind { BasicLCD, LAALCD };
+
+static cl::opt<LCDAnalysisKind> LCDAnalysisImpl(
+    "lcd-analysis-impl", cl::desc("Loop-carried dependency analysis to use"),
+    cl::values(clEnumValN(BasicLCD, "basic", "Based on DependenceAnalysis"),
+               clEnumValN(LAALCD, "laa",
+                          "Based on LoopAccessAnalysis and SCEV"),
+               clEnumValEnd),
+    cl::init(BasicLCD));
+
 namespace util {
 class BasicLCDAnalysis : public LoopCarriedDependencyAnalysis {
 public:
@@ -130,7 +142,17 @@ bool BasicLCDAnalysis::getLCDDistance(Instruction *I, const Loop *L,
       const SCEV *Dist = (*D)->getDistance(LoopLevel);
       const SCEVConstant *SCEVConst = dyn_cast_or_null<SCEVConstant>(Dist);
       if (SCEVConst) {
-        Distance = std::min(SCEVConst->getValue()->getSExtValue(), Distance);
+        // The dependencies are computed from I to the other access: for a
+        // load the store is the destination, flip the sign to count from
+        // the store to the load.
+        long int D = SCEVConst->getValue()->getSExtValue();
+        if (isa<LoadInst>(I)) {
+          D = -D;
+        }
+        // Negative: the location is read before it is written
+        if (D >= 0) {
+          Distance = std::min(D, Distance);
+        }
       } else {
         ValidDistance = false;
         break;
@@ -243,9 +265,18 @@ bool LoopCarriedDependencyAnalysisWrapperPass::runOnFunction(Function &F) {
     delete LCDAnalysis;
   }
 
-  LCDAnalysis =
-      new BasicLCDAnalysis(&getAnalysis<DependenceAnalysis>(),
-                           &getAnalysis<LoopInfoWrapperPass>().getLoopInfo());
+  LoopInfo *LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  switch (LCDAnalysisImpl) {
+  case LAALCD:
+    LCDAnalysis = new LAALCDAnalysis(
+        &getAnalysis<LoopAccessAnalysis>(),
+        &getAnalysis<ScalarEvolutionWrapperPass>().getSE(),
+        &getAnalysis<AAResultsWrapperPass>().getAAResults(), LI);
+    break;
+  case BasicLCD:
+    LCDAnalysis = new BasicLCDAnalysis(&getAnalysis<DependenceAnalysis>(), LI);
+    break;
+  }
   LCDAnalysis->setup(F);
   return false;
 }
@@ -254,7 +285,16 @@ void LoopCarriedDependencyAnalysisWrapperPass::getAnalysisUsage(
     AnalysisUsage &AU) const {
   AU.setPreservesAll();
   AU.addRequired<LoopInfoWrapperPass>();
-  AU.addRequired<DependenceAnalysis>();
+  switch (LCDAnalysisImpl) {
+  case LAALCD:
+    AU.addRequired<LoopAccessAnalysis>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<AAResultsWrapperPass>();
+    break;
+  case BasicLCD:
+    AU.addRequired<DependenceAnalysis>();
+    break;
+  }
 }
 
 void LoopCarriedDependencyAnalysisWrapperPass::
@@ -0,0 +1,131 @@
+//===-------- IndirectionDepth.cpp - Depth of dependent load chains -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file IndirectionDepth.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Implementation of IndirectionDepth.h
+//===----------------------------------------------------------------------===//
+
+#include "Util/Analysis/IndirectionDepth.h"
+#include "Util/Analysis/LoopDependency.h"
+#include "Util/Annotation/MetadataInfo.h"
+
+#include "llvm/IR/InstIterator.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
+static cl::opt<unsigned>
+    LongLoadLatency("indir-long-latency",
+                    cl::desc("Estimated latency of a long latency load"),
+                    cl::init(200));
+
+static cl::opt<unsigned>
+    ShortLoadLatency("indir-short-latency",
+                     cl::desc("Estimated latency of any other load"),
+                     cl::init(4));
+
+namespace util {
+  void IndirectionDepth::analyze(const set<LoadInst *> &Loads) {
+    Nodes.clear();
+    for (LoadInst *L : Loads) {
+      Nodes[L] = {set<LoadInst *>(), 0, 0, false};
+    }
+    build();
+  }
+
+  void IndirectionDepth::analyze(const list<LoadInst *> &Loads) {
+    analyze(set<LoadInst *>(Loads.begin(), Loads.end()));
+  }
+
+  void IndirectionDepth::analyze(Function &F) {
+    set<LoadInst *> Loads;
+    for (inst_iterator I = inst_begin(F), IE = inst_end(F); I != IE; ++I) {
+      if (LoadInst *L = dyn_cast<LoadInst>(&*I)) {
+        if (LI->getLoopFor(L->getParent())) {
+          Loads.insert(L);
+        }
+      }
+    }
+    analyze(Loads);
+  }
+
+  void IndirectionDepth::build() {
+    for (auto &N : Nodes) {
+      set<Instruction *> Deps;
+      getRequirementsInIteration(AA, LI, N.first, Deps);
+      for (Instruction *D : Deps) {
+        LoadInst *DL = dyn_cast<LoadInst>(D);
+        if (DL && DL != N.first && Nodes.count(DL)) {
+          N.second.Preds.insert(DL);
+        }
+      }
+    }
+
+    MaxDepth = 0;
+    for (auto &N : Nodes) {
+      visit(N.first, N.second);
+      MaxDepth = max(MaxDepth, N.second.Depth);
+    }
+  }
+
+  // Requirements within an iteration are acyclic. Should that not hold, a
+  // load on a cycle is seen with the depth and latency computed so far.
+  void IndirectionDepth::visit(LoadInst *L, Node &N) {
+    if (N.Visited) {
+      return;
+    }
+    N.Visited = true;
+
+    unsigned PredDepth = 0, PredLatency = 0;
+    for (LoadInst *P : N.Preds) {
+      Node &PN = Nodes[P];
+      visit(P, PN);
+      PredDepth = max(PredDepth, PN.Depth + 1);
+      PredLatency = max(PredLatency, PN.Latency);
+    }
+
+    N.Depth = PredDepth;
+    N.Latency = PredLatency + (InstrhasMetadata(L, "Latency", "Long")
+                                   ? LongLoadLatency
+                                   : ShortLoadLatency);
+  }
+
+  unsigned IndirectionDepth::getDepth(LoadInst *L) const {
+    auto N = Nodes.find(L);
+    return N == Nodes.end() ? 0 : N->second.Depth;
+  }
+
+  unsigned IndirectionDepth::getLatency(LoadInst *L) const {
+    auto N = Nodes.find(L);
+    return N == Nodes.end() ? 0 : N->second.Latency;
+  }
+
+  void IndirectionDepth::getLevels(vector<set<LoadInst *>> &Levels) const {
+    if (Nodes.empty()) {
+      return;
+    }
+
+    Levels.resize(MaxDepth + 1);
+    for (auto &N : Nodes) {
+      Levels[N.second.Depth].insert(N.first);
+    }
+  }
+
+  void IndirectionDepth::annotate() const {
+    for (auto &N : Nodes) {
+      AttachMetadata(N.first, "IndirDepth", to_string(N.second.Depth));
+      AttachMetadata(N.first, "IndirLatency", to_string(N.second.Latency));
+    }
+  }
+}
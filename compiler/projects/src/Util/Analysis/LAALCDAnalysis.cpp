@@ -0,0 +1,280 @@
+//===- LAALCDAnalysis.cpp - LCD Analysis based on LoopAccessAnalysis ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file LAALCDAnalysis.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+// This file defines the loop carried dependency analysis based on LLVM's
+// LoopAccessAnalysis and scalar evolution. For every pair of a load and a
+// store in the loop that may alias, the distance is computed from the SCEV of
+// their addresses. Pairs whose addresses are not comparable are settled with
+// the result of LoopAccessAnalysis: independent if its dependence checker
+// found no dependence between them, MayLCD otherwise. Pairs that
+// LoopAccessAnalysis only separates by runtime checks are MayLCD and mark
+// the loop as requiring memory checks.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Util/Analysis/LAALCDAnalysis.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <climits>
+#include <queue>
+
+#define DEBUG_TYPE "-lcd-analysis"
+
+using namespace llvm;
+using namespace util;
+
+namespace {
+enum PairRelation {
+  // The load never reads a location written by the store
+  Independent,
+
+  // The load reads what the store wrote a constant number of iterations
+  // earlier (possibly in the same iteration)
+  Dependent,
+
+  // Addresses not comparable with SCEV
+  Unknown
+};
+}
+
+// Relation of Load and Store in L. For Dependent, Distance is the smallest
+// number of iterations D >= 0 such that Store in iteration k writes the
+// location Load reads in iteration k + D.
+static PairRelation getPairRelation(ScalarEvolution *SE, const Loop *L,
+                                    LoadInst *Load, StoreInst *Store,
+                                    long int &Distance) {
+  const DataLayout &DL = Load->getModule()->getDataLayout();
+  int64_t LoadSize = DL.getTypeStoreSize(Load->getType());
+  int64_t StoreSize = DL.getTypeStoreSize(Store->getValueOperand()->getType());
+
+  const SCEV *LoadPtr = SE->getSCEV(Load->getPointerOperand());
+  const SCEV *StorePtr = SE->getSCEV(Store->getPointerOperand());
+  const SCEVConstant *Diff =
+      dyn_cast<SCEVConstant>(SE->getMinusSCEV(StorePtr, LoadPtr));
+  if (!Diff) {
+    return Unknown;
+  }
+  int64_t Offset = Diff->getValue()->getSExtValue();
+
+  // Both access the same location in every iteration
+  if (SE->isLoopInvariant(LoadPtr, L) && SE->isLoopInvariant(StorePtr, L)) {
+    if (Offset >= LoadSize || -Offset >= StoreSize) {
+      return Independent;
+    }
+    Distance = 0;
+    return Dependent;
+  }
+
+  const SCEVAddRecExpr *LoadAR = dyn_cast<SCEVAddRecExpr>(LoadPtr);
+  const SCEVAddRecExpr *StoreAR = dyn_cast<SCEVAddRecExpr>(StorePtr);
+  if (!LoadAR || !StoreAR || LoadAR->getLoop() != L ||
+      StoreAR->getLoop() != L || !LoadAR->isAffine() || !StoreAR->isAffine()) {
+    return Unknown;
+  }
+
+  const SCEV *Step = LoadAR->getStepRecurrence(*SE);
+  const SCEVConstant *ConstStep = dyn_cast<SCEVConstant>(Step);
+  if (!ConstStep || Step != StoreAR->getStepRecurrence(*SE)) {
+    return Unknown;
+  }
+
+  // Only exact matches of the addresses are handled: the accesses of
+  // different iterations must not partially overlap.
+  int64_t Stride = ConstStep->getValue()->getSExtValue();
+  int64_t AbsStride = Stride < 0 ? -Stride : Stride;
+  if (Stride == 0 || LoadSize > AbsStride || StoreSize > AbsStride ||
+      Offset % Stride != 0) {
+    return Unknown;
+  }
+
+  // Negative: the location is read before it is written
+  Distance = Offset / Stride;
+  return Distance >= 0 ? Dependent : Independent;
+}
+
+static bool groupContains(const RuntimePointerChecking *PtrChecking,
+                          const RuntimePointerChecking::CheckingPtrGroup *G,
+                          Value *Ptr) {
+  for (unsigned Index : G->Members) {
+    Value *Member = PtrChecking->Pointers[Index].PointerValue;
+    if (Member == Ptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool util::isCheckedAtRuntime(const RuntimePointerChecking *PtrChecking,
+                              Value *A, Value *B) {
+  if (!PtrChecking->Need) {
+    return false;
+  }
+
+  for (const RuntimePointerChecking::PointerCheck &Check :
+       PtrChecking->getChecks()) {
+    if ((groupContains(PtrChecking, Check.first, A) &&
+         groupContains(PtrChecking, Check.second, B)) ||
+        (groupContains(PtrChecking, Check.first, B) &&
+         groupContains(PtrChecking, Check.second, A))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns true if the dependence checker recorded a dependence between A and B
+static bool hasDependence(const LoopAccessInfo &LAI, Instruction *A,
+                          Instruction *B) {
+  const SmallVectorImpl<MemoryDepChecker::Dependence> *Deps =
+      LAI.getDepChecker().getDependences();
+  if (!Deps) {
+    // Too many dependences to record, assume the worst
+    return true;
+  }
+
+  for (const MemoryDepChecker::Dependence &Dep : *Deps) {
+    if (Dep.Type == MemoryDepChecker::Dependence::NoDep) {
+      continue;
+    }
+
+    Instruction *Src = Dep.getSource(LAI);
+    Instruction *Dst = Dep.getDestination(LAI);
+    if ((Src == A && Dst == B) || (Src == B && Dst == A)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+LAALCDAnalysis::~LAALCDAnalysis() {
+  for (auto &M : LoopToMemInst) {
+    delete M.second;
+  }
+}
+
+void LAALCDAnalysis::setup(Function &F) {
+  std::queue<const Loop *> Loops;
+
+  for (LoopInfo::iterator L = LI->begin(), LE = LI->end(); L != LE; ++L) {
+    Loops.push(*L);
+  }
+
+  while (!Loops.empty()) {
+    const Loop *LP = Loops.front();
+    Loops.pop();
+
+    InstVectorTy *MemInst = new InstVectorTy();
+    collectMemInst(*LP, *MemInst);
+    LoopToMemInst[LP] = MemInst;
+
+    for (auto SL : LP->getSubLoops()) {
+      Loops.push(SL);
+    }
+  }
+}
+
+const LoopAccessInfo &LAALCDAnalysis::getAccessInfo(const Loop *L) {
+  // No symbolic strides: they would require versioning the loop
+  ValueToValueMap Strides;
+  return LAA->getInfo(const_cast<Loop *>(L), Strides);
+}
+
+LAALCDAnalysis::LCDEntry LAALCDAnalysis::analyze(Instruction *I,
+                                                 const Loop *L) {
+  LCDEntry Entry = {LCDResult::NoLCD, true, LONG_MAX, false};
+  if (!isa<LoadInst>(I) && !isa<StoreInst>(I)) {
+    return Entry;
+  }
+
+  const LoopAccessInfo &LAI = getAccessInfo(L);
+  InstVectorTy *MemInst = LoopToMemInst[L];
+  if (!MemInst) {
+    Entry.LCD = LCDResult::MayLCD;
+    Entry.HasDistance = false;
+    return Entry;
+  }
+
+  for (Instruction *Other : *MemInst) {
+    if (isa<LoadInst>(I) == isa<LoadInst>(Other)) {
+      continue;
+    }
+
+    LoadInst *Load = cast<LoadInst>(isa<LoadInst>(I) ? I : Other);
+    StoreInst *Store = cast<StoreInst>(isa<StoreInst>(I) ? I : Other);
+    if (AA->alias(MemoryLocation::get(Load), MemoryLocation::get(Store)) ==
+        NoAlias) {
+      continue;
+    }
+
+    long int Distance;
+    PairRelation Relation = getPairRelation(SE, L, Load, Store, Distance);
+    if (Relation == Independent) {
+      continue;
+    }
+
+    if (Relation == Dependent) {
+      Entry.LCD = LCDResult::MustLCD;
+      Entry.Distance = std::min(Entry.Distance, Distance);
+      continue;
+    }
+
+    // Not comparable with SCEV: rely on LoopAccessAnalysis
+    if (isCheckedAtRuntime(LAI.getRuntimePointerChecking(),
+                           Load->getPointerOperand(),
+                           Store->getPointerOperand())) {
+      Entry.NeedsMemChecks = true;
+    } else if (LAI.canVectorizeMemory() && !hasDependence(LAI, Load, Store)) {
+      continue;
+    }
+
+    Entry.LCD = combineLCD(Entry.LCD, LCDResult::MayLCD);
+    Entry.HasDistance = false;
+  }
+
+  DEBUG(dbgs() << "LAA LCD: " << *I << ": " << getStringRep(Entry.LCD)
+               << (Entry.NeedsMemChecks ? " (memchecks)" : "") << "\n");
+  return Entry;
+}
+
+const LAALCDAnalysis::LCDEntry &LAALCDAnalysis::getEntry(Instruction *I,
+                                                         const Loop *L) {
+  DependenceKey Key = std::make_pair(L, I);
+  std::map<DependenceKey, LCDEntry>::iterator E = LCDCache.find(Key);
+  if (E == LCDCache.end()) {
+    E = LCDCache.insert(std::make_pair(Key, analyze(I, L))).first;
+  }
+  return E->second;
+}
+
+const LCDResult LAALCDAnalysis::checkLCD(Instruction *I, const Loop *L) {
+  return getEntry(I, L).LCD;
+}
+
+bool LAALCDAnalysis::getLCDDistance(Instruction *I, const Loop *L,
+                                    long int &Distance) {
+  const LCDEntry &Entry = getEntry(I, L);
+  Distance = Entry.Distance;
+  return Entry.HasDistance;
+}
+
+bool LAALCDAnalysis::requiresMemoryChecks(const Loop *L, unsigned &NumChecks) {
+  const LoopAccessInfo &LAI = getAccessInfo(L);
+  NumChecks = LAI.getNumRuntimePointerChecks();
+  return LAI.getRuntimePointerChecking()->Need;
+}
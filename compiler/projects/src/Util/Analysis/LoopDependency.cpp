@@ -18,6 +18,7 @@
 
 #include "Util/Analysis/LoopDependency.h"
 #include "Util/Annotation/MetadataInfo.h"
+#include "Util/Analysis/ModRefSummary.h"
 
 // Set the minimum alias requirement to follow a store.
 // Without flag stores are not followed at all.
@@ -55,8 +56,9 @@ namespace util {
   }
 
 
-  // Adds all StoreInsts that could be responsible for the value read
-  // by LInst to Set and Q under the same condition as in enqueueInst.
+  // Adds all StoreInsts, and copyable calls, that could be responsible for
+  // the value read by LInst to Set and Q under the same condition as in
+  // enqueueInst.
   void enqueueStores(AliasAnalysis *AA, LoadInst *LInst, set<Instruction *> &Set,
                      queue<Instruction *> &Q) {
     BasicBlock *loadBB = LInst->getParent();
@@ -77,8 +79,7 @@ namespace util {
            iI != iE; ++iI) {
         if (StoreInst::classof(&(*iI))) {
           StoreInst *SInst = (StoreInst *)&(*iI);
-          switch (pointerAlias(AA, SInst->getPointerOperand(), Pointer,
-                               iI->getModule()->getDataLayout())) {
+          switch (instructionAlias(AA, SInst, LInst)) {
           case AliasResult::MustAlias:
             if (FollowMust || FollowPartial || FollowMay) {
               found = true;
@@ -98,6 +99,13 @@ namespace util {
           case AliasResult::NoAlias:
             break;
           }
+        } else if (isCopyableCall(&(*iI))) {
+          // A helper that may write the loaded location through a local
+          // pointer is followed like a store that may alias
+          ModRefInfo MRI = AA->getModRefInfo(&(*iI), MemoryLocation::get(LInst));
+          if ((MRI & MRI_Mod) && (FollowMust || FollowPartial || FollowMay)) {
+            enqueueInst(&(*iI), Set, Q);
+          }
         } else if (Pointer == &(*iI)) {
           found = true;
         }
@@ -157,6 +165,11 @@ namespace util {
           hasNoModifyingCalls = true;
         }
 
+        // Allow calls that the summaries show to only write local memory
+        if (!hasNoModifyingCalls && isCopyableCall(Call)) {
+          hasNoModifyingCalls = true;
+        }
+
 	// Allow swoop types
 	if (InstrhasMetadataKind(Call, "SwoopType")) {
 	  if ("ReuseHelper" == getInstructionMD(Call, "SwoopType")) {
@@ -283,7 +296,7 @@ namespace util {
         bool onlyReadsMemory = ((CallInst *)Inst)->onlyReadsMemory();
         bool annotatedToBeLocal = InstrhasMetadata(Inst, "Call", "Local");
 
-        res = onlyReadsMemory || annotatedToBeLocal;
+        res = onlyReadsMemory || annotatedToBeLocal || isCopyableCall(Inst);
         if (!res) {
           errs() << " !call " << *Inst << "!>\n";
         }
@@ -0,0 +1,176 @@
+//===-------- ModRefSummary.cpp - Per function mod/ref summaries ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file ModRefSummary.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Implementation of ModRefSummary.h
+//===----------------------------------------------------------------------===//
+
+#include "Util/Analysis/ModRefSummary.h"
+#include "Util/DAE/DAEUtils.h"
+
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CFG.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+namespace util {
+  static const FunctionSummary Unknown = {true, true, false};
+
+  static const ModRefSummaries *CurrentSummaries = nullptr;
+
+  void setModRefSummaries(const ModRefSummaries *S) { CurrentSummaries = S; }
+
+  bool isCopyableCall(Instruction *Inst) {
+    CallInst *Call = dyn_cast<CallInst>(Inst);
+    return CurrentSummaries && Call && CurrentSummaries->isCopyableCall(Call);
+  }
+
+  // Records a write through Ptr, from within F, in S
+  static void addWrite(FunctionSummary &S, Value *Ptr, const DataLayout &DL) {
+    Value *Obj = GetUnderlyingObject(Ptr, DL);
+    if (isa<AllocaInst>(Obj)) {
+      // Local to the function
+      return;
+    }
+
+    if (isa<Argument>(Obj)) {
+      S.WritesArgMemory = true;
+    } else {
+      S.WritesOtherMemory = true;
+    }
+  }
+
+  void ModRefSummaries::analyze(Module &M) {
+    Summaries.clear();
+
+    // Bottom-up, so that callees are summarized before their callers
+    CallGraph CG(M);
+    for (scc_iterator<CallGraph *> SCC = scc_begin(&CG); !SCC.isAtEnd(); ++SCC) {
+      bool Recursive = SCC.hasLoop();
+      for (CallGraphNode *Node : *SCC) {
+        Function *F = Node->getFunction();
+        if (!F) {
+          continue;
+        }
+
+        if (F->isDeclaration()) {
+          Summaries[F] = summarizeDeclaration(*F);
+        } else if (Recursive) {
+          Summaries[F] = Unknown;
+        } else {
+          Summaries[F] = summarize(*F);
+        }
+      }
+    }
+  }
+
+  const FunctionSummary *ModRefSummaries::getSummary(const Function *F) const {
+    auto S = Summaries.find(F);
+    return S == Summaries.end() ? nullptr : &S->second;
+  }
+
+  FunctionSummary ModRefSummaries::summarizeDeclaration(Function &F) const {
+    if (F.getIntrinsicID() == Intrinsic::prefetch) {
+      return {false, false, true};
+    }
+
+    FunctionSummary S = {false, false, F.doesNotThrow() && !F.doesNotReturn()};
+    if (!F.onlyReadsMemory()) {
+      if (F.onlyAccessesArgMemory()) {
+        S.WritesArgMemory = true;
+      } else {
+        S.WritesOtherMemory = true;
+      }
+    }
+    return S;
+  }
+
+  FunctionSummary ModRefSummaries::summarize(Function &F) const {
+    const DataLayout &DL = F.getParent()->getDataLayout();
+    FunctionSummary S = {false, false, true};
+
+    // Loops are not known to terminate
+    SmallVector<std::pair<const BasicBlock *, const BasicBlock *>, 4> Backedges;
+    FindFunctionBackedges(F, Backedges);
+    if (!Backedges.empty()) {
+      S.Speculatable = false;
+    }
+
+    for (inst_iterator I = inst_begin(F), IE = inst_end(F); I != IE; ++I) {
+      Instruction *Inst = &*I;
+
+      if (StoreInst *Store = dyn_cast<StoreInst>(Inst)) {
+        if (!Store->isSimple()) {
+          return Unknown;
+        }
+        addWrite(S, Store->getPointerOperand(), DL);
+      } else if (LoadInst *Load = dyn_cast<LoadInst>(Inst)) {
+        if (!Load->isSimple()) {
+          return Unknown;
+        }
+        // A load through a pointer not known to be dereferenceable may fault
+        S.Speculatable &= isSafeToSpeculativelyExecute(Load);
+      } else if (isa<BinaryOperator>(Inst)) {
+        // Integer division may trap
+        S.Speculatable &= isSafeToSpeculativelyExecute(Inst);
+      } else if (MemIntrinsic *MI = dyn_cast<MemIntrinsic>(Inst)) {
+        if (MI->isVolatile()) {
+          return Unknown;
+        }
+        addWrite(S, MI->getDest(), DL);
+      } else if (CallInst *Call = dyn_cast<CallInst>(Inst)) {
+        const FunctionSummary *Callee = getSummary(Call->getCalledFunction());
+        if (!Callee) {
+          // Indirect call, inline asm, or a callee in the same SCC
+          return Unknown;
+        }
+
+        S.WritesOtherMemory |= Callee->WritesOtherMemory;
+        S.Speculatable &= Callee->Speculatable;
+        if (Callee->WritesArgMemory) {
+          for (Value *Arg : Call->arg_operands()) {
+            if (Arg->getType()->isPointerTy()) {
+              addWrite(S, Arg, DL);
+            }
+          }
+        }
+      } else if (isa<InvokeInst>(Inst) || isa<ResumeInst>(Inst) ||
+                 isa<LandingPadInst>(Inst) || isa<UnreachableInst>(Inst) ||
+                 isa<FenceInst>(Inst) || isa<AtomicRMWInst>(Inst) ||
+                 isa<AtomicCmpXchgInst>(Inst) || isa<VAArgInst>(Inst)) {
+        return Unknown;
+      }
+    }
+
+    return S;
+  }
+
+  bool ModRefSummaries::isCopyableCall(CallInst *Call) const {
+    const FunctionSummary *S = getSummary(Call->getCalledFunction());
+    if (!S || !S->Speculatable || S->WritesOtherMemory) {
+      return false;
+    }
+
+    if (S->WritesArgMemory) {
+      for (Value *Arg : Call->arg_operands()) {
+        if (Arg->getType()->isPointerTy() && !isLocalPointer(Arg)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+}
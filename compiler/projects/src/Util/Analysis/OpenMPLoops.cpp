@@ -0,0 +1,165 @@
+//===------- OpenMPLoops.cpp - OpenMP worksharing loops -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file OpenMPLoops.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Implementation of OpenMPLoops.h
+//===----------------------------------------------------------------------===//
+
+#include "Util/Analysis/OpenMPLoops.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/InstIterator.h"
+
+#include <set>
+
+namespace util {
+  // Operands of __kmpc_for_static_init: loc, gtid, schedule, plastiter,
+  // plower, pupper, pstride, incr, chunk
+  static const unsigned FirstBoundArg = 3;
+  static const unsigned LowerArg = 4;
+  static const unsigned UpperArg = 5;
+  static const unsigned LastBoundArg = 6;
+
+  static bool isRuntimeCall(const CallInst *Call) {
+    const Function *Callee = Call->getCalledFunction();
+    return Callee && (Callee->getName().startswith("__kmpc_") || Callee->isIntrinsic());
+  }
+
+  void findStaticInitCalls(Function &F, std::vector<CallInst *> &Calls) {
+    for (inst_iterator iI = inst_begin(F), iE = inst_end(F); iI != iE; ++iI) {
+      CallInst *Call = dyn_cast<CallInst>(&*iI);
+      if (!Call || !Call->getCalledFunction() ||
+          !Call->getCalledFunction()->getName().startswith("__kmpc_for_static_init") ||
+          Call->getNumArgOperands() <= LastBoundArg) {
+        continue;
+      }
+      Calls.push_back(Call);
+    }
+  }
+
+  // Adds the stores and runtime calls that write Bound to Writers, and its
+  // loads to Loads. Returns false if Bound is used in any other way, i.e.
+  // may be written by other instructions as well.
+  static bool getBoundAccesses(Value *Bound, std::vector<Instruction *> &Writers,
+                               std::vector<LoadInst *> &Loads) {
+    for (User *U : Bound->users()) {
+      if (LoadInst *Load = dyn_cast<LoadInst>(U)) {
+        if (!Load->isSimple()) {
+          return false;
+        }
+        Loads.push_back(Load);
+      } else if (StoreInst *Store = dyn_cast<StoreInst>(U)) {
+        if (Store->getValueOperand() == Bound) {
+          return false;
+        }
+        Writers.push_back(Store);
+      } else if (BitCastInst *Cast = dyn_cast<BitCastInst>(U)) {
+        if (!getBoundAccesses(Cast, Writers, Loads)) {
+          return false;
+        }
+      } else if (isa<CallInst>(U) && isRuntimeCall(cast<CallInst>(U))) {
+        Writers.push_back(cast<CallInst>(U));
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static AllocaInst *getBound(CallInst *Init, unsigned Arg) {
+    return dyn_cast<AllocaInst>(Init->getArgOperand(Arg)->stripPointerCasts());
+  }
+
+  static bool writesAny(Loop *L, std::vector<Instruction *> &Writers) {
+    return any_of(Writers.begin(), Writers.end(),
+                  [&](Instruction *W) { return L->contains(W); });
+  }
+
+  unsigned hoistChunkBoundLoads(Function &F, LoopInfo &LI) {
+    std::vector<CallInst *> Inits;
+    findStaticInitCalls(F, Inits);
+
+    std::set<AllocaInst *> Bounds;
+    for (CallInst *Init : Inits) {
+      for (unsigned Arg = FirstBoundArg; Arg <= LastBoundArg; ++Arg) {
+        if (AllocaInst *Bound = getBound(Init, Arg)) {
+          Bounds.insert(Bound);
+        }
+      }
+    }
+
+    unsigned Hoisted = 0;
+    for (AllocaInst *Bound : Bounds) {
+      std::vector<Instruction *> Writers;
+      std::vector<LoadInst *> Loads;
+      if (!getBoundAccesses(Bound, Writers, Loads)) {
+        continue;
+      }
+
+      for (LoadInst *Load : Loads) {
+        // Loads through a cast would need the cast to be moved as well
+        if (Load->getPointerOperand() != Bound) {
+          continue;
+        }
+
+        // A load of an alloca cannot fault, so it does not matter whether
+        // the loop would have executed it
+        Loop *Target = nullptr;
+        for (Loop *L = LI.getLoopFor(Load->getParent()); L; L = L->getParentLoop()) {
+          if (!L->getLoopPreheader() || writesAny(L, Writers)) {
+            break;
+          }
+          Target = L;
+        }
+
+        if (Target) {
+          Load->moveBefore(Target->getLoopPreheader()->getTerminator());
+          ++Hoisted;
+        }
+      }
+    }
+
+    return Hoisted;
+  }
+
+  void findStaticChunkLoops(Function &F, LoopInfo &LI, DominatorTree &DT,
+                            std::vector<Loop *> &Loops) {
+    std::vector<CallInst *> Inits;
+    findStaticInitCalls(F, Inits);
+
+    for (CallInst *Init : Inits) {
+      AllocaInst *Lower = getBound(Init, LowerArg);
+      AllocaInst *Upper = getBound(Init, UpperArg);
+      std::vector<Instruction *> Writers;
+      std::vector<LoadInst *> Loads;
+      if (!Lower || !Upper || !getBoundAccesses(Lower, Writers, Loads) ||
+          !getBoundAccesses(Upper, Writers, Loads)) {
+        continue;
+      }
+
+      // A dispatch loop moves the bounds on, the chunk loop is inside it
+      std::vector<Loop *> Worklist(LI.begin(), LI.end());
+      while (!Worklist.empty()) {
+        Loop *L = Worklist.back();
+        Worklist.pop_back();
+
+        if (L->contains(Init) || writesAny(L, Writers)) {
+          Worklist.insert(Worklist.end(), L->begin(), L->end());
+        } else if (DT.dominates(Init, &L->getHeader()->front())) {
+          Loops.push_back(L);
+        }
+      }
+    }
+  }
+}
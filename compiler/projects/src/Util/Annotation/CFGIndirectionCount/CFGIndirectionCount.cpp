@@ -29,6 +29,7 @@
 
 #include "Util/Annotation/MetadataInfo.h"
 #include "Util/Analysis/LoopDependency.h"
+#include "Util/Pipeline/SharedOptions.h"
 
 #define DEBUG_TYPE "CFGIndirectionCount"
 
@@ -36,11 +37,6 @@ using namespace llvm;
 using namespace std;
 using namespace util;
 
-static cl::opt<std::string>
-    LoopName("loop-name",
-             cl::desc("The keyword identifying the loop header to annotate"),
-             cl::value_desc("name"));
-
 namespace {
 struct CFGIndirectionCount : public LoopPass {
   static char ID;
@@ -0,0 +1,168 @@
+//===------- LoopHints.cpp - Per-loop Clairvoyance hints ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file LoopHints.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Implementation of LoopHints.h
+//===----------------------------------------------------------------------===//
+
+#include "Util/Annotation/LoopHints.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+
+#include <vector>
+
+namespace util {
+  static const StringRef Prefix = "clairvoyance.";
+
+  bool getClairvoyanceHints(const Loop *L, ClairvoyanceHints &Hints) {
+    MDNode *LoopID = L->getLoopID();
+    if (!LoopID) {
+      return false;
+    }
+
+    bool Found = false;
+    // The first operand refers to the loop id itself
+    for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i) {
+      const MDNode *MD = dyn_cast<MDNode>(LoopID->getOperand(i));
+      if (!MD || MD->getNumOperands() != 2) {
+        continue;
+      }
+
+      const MDString *S = dyn_cast<MDString>(MD->getOperand(0));
+      if (!S || !S->getString().startswith(Prefix)) {
+        continue;
+      }
+      StringRef Name = S->getString().substr(Prefix.size());
+
+      if (Name == "type") {
+        if (const MDString *Type = dyn_cast<MDString>(MD->getOperand(1))) {
+          Hints.Type = Type->getString().str();
+          Found = true;
+        }
+        continue;
+      }
+
+      const ConstantInt *C = mdconst::dyn_extract<ConstantInt>(MD->getOperand(1));
+      if (!C) {
+        continue;
+      }
+      unsigned Val = C->getZExtValue();
+
+      if (Name == "enable") {
+        Hints.Enable = Val != 0;
+        Hints.HasEnable = true;
+      } else if (Name == "unroll") {
+        Hints.Unroll = Val;
+        Hints.HasUnroll = true;
+      } else if (Name == "indir") {
+        Hints.Indir = Val;
+        Hints.HasIndir = true;
+      } else {
+        continue;
+      }
+      Found = true;
+    }
+    return Found;
+  }
+
+  bool getClairvoyanceHintsInNest(const Loop *L, ClairvoyanceHints &Hints) {
+    bool Found = false;
+    for (; L; L = L->getParentLoop()) {
+      ClairvoyanceHints Outer;
+      if (!getClairvoyanceHints(L, Outer)) {
+        continue;
+      }
+      Found = true;
+
+      // Hints of inner loops take precedence
+      if (!Hints.HasEnable) {
+        Hints.Enable = Outer.Enable;
+        Hints.HasEnable = Outer.HasEnable;
+      }
+      if (!Hints.HasUnroll) {
+        Hints.Unroll = Outer.Unroll;
+        Hints.HasUnroll = Outer.HasUnroll;
+      }
+      if (!Hints.HasIndir) {
+        Hints.Indir = Outer.Indir;
+        Hints.HasIndir = Outer.HasIndir;
+      }
+      if (Hints.Type.empty()) {
+        Hints.Type = Outer.Type;
+      }
+    }
+    return Found;
+  }
+
+  void setClairvoyanceHints(Loop *L, const ClairvoyanceHints &Hints) {
+    LLVMContext &Context = L->getHeader()->getContext();
+
+    // Reserve the first operand for the self reference
+    SmallVector<Metadata *, 8> MDs;
+    MDs.push_back(nullptr);
+
+    if (MDNode *LoopID = L->getLoopID()) {
+      for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i) {
+        const MDNode *MD = dyn_cast<MDNode>(LoopID->getOperand(i));
+        const MDString *S =
+            MD && MD->getNumOperands() ? dyn_cast<MDString>(MD->getOperand(0)) : nullptr;
+        if (!S || !S->getString().startswith(Prefix)) {
+          MDs.push_back(LoopID->getOperand(i));
+        }
+      }
+    }
+
+    auto addHint = [&](StringRef Name, Metadata *Value) {
+      Metadata *Ops[] = {MDString::get(Context, (Prefix + Name).str()), Value};
+      MDs.push_back(MDNode::get(Context, Ops));
+    };
+    auto getInt = [&](Type *T, unsigned Val) {
+      return ConstantAsMetadata::get(ConstantInt::get(T, Val));
+    };
+
+    if (Hints.HasEnable) {
+      addHint("enable", getInt(Type::getInt1Ty(Context), Hints.Enable));
+    }
+    if (Hints.HasUnroll) {
+      addHint("unroll", getInt(Type::getInt32Ty(Context), Hints.Unroll));
+    }
+    if (Hints.HasIndir) {
+      addHint("indir", getInt(Type::getInt32Ty(Context), Hints.Indir));
+    }
+    if (!Hints.Type.empty()) {
+      addHint("type", MDString::get(Context, Hints.Type));
+    }
+
+    MDNode *NewLoopID = MDNode::get(Context, MDs);
+    NewLoopID->replaceOperandWith(0, NewLoopID);
+    L->setLoopID(NewLoopID);
+  }
+
+  bool hasClairvoyanceLoops(const LoopInfo &LI) {
+    std::vector<const Loop *> Worklist(LI.begin(), LI.end());
+    while (!Worklist.empty()) {
+      const Loop *L = Worklist.back();
+      Worklist.pop_back();
+
+      ClairvoyanceHints Hints;
+      if (getClairvoyanceHints(L, Hints) && Hints.Enable) {
+        return true;
+      }
+      Worklist.insert(Worklist.end(), L->begin(), L->end());
+    }
+    return false;
+  }
+}
@@ -149,6 +149,114 @@ namespace util {
     }
   }
 
+  bool isAccessIntrinsic(Instruction *I) {
+    IntrinsicInst *II = dyn_cast<IntrinsicInst>(I);
+    if (!II) {
+      return false;
+    }
+
+    switch (II->getIntrinsicID()) {
+    case Intrinsic::masked_gather:
+    case Intrinsic::masked_load:
+    case Intrinsic::memcpy:
+    case Intrinsic::memmove:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  Value *getAccessIntrinsicAddress(IntrinsicInst *I) {
+    if (MemTransferInst *Transfer = dyn_cast<MemTransferInst>(I)) {
+      return Transfer->getRawSource();
+    }
+    return I->getArgOperand(0);
+  }
+
+  void findAccessIntrinsics(Function &F, list<IntrinsicInst *> &List) {
+    for (inst_iterator iI = inst_begin(F), iE = inst_end(F); iI != iE; ++iI) {
+      if (isAccessIntrinsic(&*iI)) {
+        List.push_back(cast<IntrinsicInst>(&*iI));
+      }
+    }
+  }
+
+  PrefInsertResult
+  insertIntrinsicPrefetch(AliasAnalysis *AA, IntrinsicInst *I, set<Instruction *> &toKeep,
+                          unsigned Threshold, unsigned LineSize, unsigned Lines) {
+    // Follow dependencies
+    set<Instruction *> Deps;
+    if (followDeps(AA, I, Deps)) {
+      if (isUnderThreshold(Deps, Threshold)) {
+        toKeep.insert(Deps.begin(), Deps.end());
+      } else {
+        return IndirLimit;
+      }
+    } else {
+      return BadDeps;
+    }
+
+    LLVMContext &Context = I->getContext();
+    Type *I8Ptr = Type::getInt8PtrTy(Context);
+    Instruction *Prev = I->getPrevNode();
+    IRBuilder<> Builder(I);
+    Value *Addr = getAccessIntrinsicAddress(I);
+
+    // Addresses to prefetch
+    vector<Value *> Addrs;
+    switch (I->getIntrinsicID()) {
+    case Intrinsic::masked_gather: {
+      // Lanes that are known to be disabled are not read
+      Constant *Mask = dyn_cast<Constant>(I->getArgOperand(2));
+      for (unsigned i = 0, e = Addr->getType()->getVectorNumElements(); i < e; ++i) {
+        if (!Mask || !Mask->getAggregateElement(i)->isNullValue()) {
+          Addrs.push_back(Builder.CreateExtractElement(Addr, Builder.getInt32(i)));
+        }
+      }
+      break;
+    }
+    case Intrinsic::masked_load: {
+      // The vector may span two lines
+      const DataLayout &DL = I->getModule()->getDataLayout();
+      uint64_t Size = DL.getTypeStoreSize(I->getType());
+      Addrs.push_back(Addr);
+      Addrs.push_back(Builder.CreateConstGEP1_64(Builder.CreatePointerCast(Addr, I8Ptr), Size - 1));
+      break;
+    }
+    default: {
+      // Do not run past the end of a copy of known length
+      if (ConstantInt *Length = dyn_cast<ConstantInt>(cast<MemTransferInst>(I)->getLength())) {
+        uint64_t LengthLines = (Length->getZExtValue() + LineSize - 1) / LineSize;
+        Lines = min<uint64_t>(Lines, LengthLines);
+      }
+      Value *Bytes = Builder.CreatePointerCast(Addr, I8Ptr);
+      for (unsigned l = 0; l < Lines; ++l) {
+        Addrs.push_back(l ? Builder.CreateConstGEP1_64(Bytes, (uint64_t)l * LineSize) : Bytes);
+      }
+      break;
+    }
+    }
+
+    // Insert prefetches
+    Module *M = I->getModule();
+    Type *I32 = Type::getInt32Ty(Context);
+    Value *PrefFun = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
+    for (Value *A : Addrs) {
+      unsigned PtrAS = cast<PointerType>(A->getType())->getAddressSpace();
+      Value *Cast = Builder.CreatePointerCast(A, Type::getInt8PtrTy(Context, PtrAS));
+      Builder.CreateCall(PrefFun, {Cast, ConstantInt::get(I32, 0),                       // read
+                                   ConstantInt::get(I32, 3), ConstantInt::get(I32, 1)}); // data
+    }
+
+    // Keep the address computations inserted above as well
+    BasicBlock::iterator II = Prev ? ++BasicBlock::iterator(Prev) : I->getParent()->begin();
+    for (; &*II != I; ++II) {
+      toKeep.insert(&*II);
+    }
+
+    return Inserted;
+  }
+
   void findVisibleLoads(list<LoadInst *> &LoadList, list<LoadInst *> &VisList) {
     for (list<LoadInst *>::iterator I = LoadList.begin(), E = LoadList.end();
          I != E; ++I) {
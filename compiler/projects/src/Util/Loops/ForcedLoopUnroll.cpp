@@ -16,6 +16,14 @@
 // This loop pass unrolls a certain loop specified by a keyword. It unrolls
 // regardless of any unroll cost.
 //
+// With -unroll=auto the factor is chosen per loop. The loads of an iteration
+// are grouped into levels by the number of loads their address depends on
+// within the iteration; the widest level is the number of misses one
+// iteration can have in flight. The loop is unrolled until the iterations
+// fill -miss-capacity, as long as it stays within -unroll-size-budget
+// instructions and -unroll-reg-budget loaded values. The chosen factor is
+// recorded in a clairvoyance.unroll hint so that the later passes use it.
+//
 //===----------------------------------------------------------------------===//
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
@@ -23,7 +31,14 @@
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/UnrollLoop.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "Util/Annotation/LoopHints.h"
+#include "Util/Annotation/MetadataInfo.h"
+#include "Util/Pipeline/SharedOptions.h"
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <set>
 #include <llvm/IR/Dominators.h>
 #include <sys/stat.h>
 
@@ -37,14 +52,20 @@ STATISTIC(NumFailed, "Number of failed unrolled loops.");
 using namespace llvm;
 using namespace std;
 
-static cl::opt<std::string>
-    LoopName("loop-name",
-             cl::desc("The keyword identifying the loop header to unroll"),
-             cl::value_desc("name"));
+static cl::opt<unsigned> MissCapacity("miss-capacity",
+                                      cl::desc("Outstanding misses -unroll=auto aims for"),
+                                      cl::value_desc("unsigned"),
+                                      cl::init(10));
+
+static cl::opt<unsigned> UnrollSizeBudget("unroll-size-budget",
+                                          cl::desc("Max instructions of a loop unrolled by -unroll=auto"),
+                                          cl::value_desc("unsigned"),
+                                          cl::init(512));
 
-static cl::opt<unsigned>
-    UnrollCount("unroll", cl::desc("Max number of unrolled iterations"),
-                cl::value_desc("unsigned"));
+static cl::opt<unsigned> UnrollRegBudget("unroll-reg-budget",
+                                         cl::desc("Max loaded values of a loop unrolled by -unroll=auto"),
+                                         cl::value_desc("unsigned"),
+                                         cl::init(16));
 
 namespace {
 struct ForcedLoopUnroll : public LoopPass {
@@ -61,15 +82,116 @@ public:
   }
 
   virtual bool runOnLoop(Loop *L, LPPassManager &LPM);
+
+private:
+  unsigned getLoadDepth(Loop *L, Value *V, map<Value *, unsigned> &Depths,
+                        set<Value *> &InProgress);
+  unsigned chooseUnrollCount(Loop *L);
 };
 }
 
+// Number of loads on the longest chain V depends on within an iteration of
+// L. The chains end at the header phis, i.e. at the previous iteration.
+// Depths caches finished values, InProgress holds the values being computed.
+unsigned ForcedLoopUnroll::getLoadDepth(Loop *L, Value *V,
+                                        map<Value *, unsigned> &Depths,
+                                        set<Value *> &InProgress) {
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I || !L->contains(I) || (I->getParent() == L->getHeader() && isa<PHINode>(I))) {
+    return 0;
+  }
+
+  auto It = Depths.find(I);
+  if (It != Depths.end()) {
+    return It->second;
+  }
+
+  // Break cycles through inner phis
+  if (!InProgress.insert(I).second) {
+    return 0;
+  }
+
+  unsigned Depth = 0;
+  for (Value *Op : I->operands()) {
+    Depth = max(Depth, getLoadDepth(L, Op, Depths, InProgress));
+  }
+  if (isa<LoadInst>(I)) {
+    ++Depth;
+  }
+
+  InProgress.erase(I);
+  Depths[I] = Depth;
+  return Depth;
+}
+
+unsigned ForcedLoopUnroll::chooseUnrollCount(Loop *L) {
+  list<LoadInst *> Loads;
+  bool Marked = false;
+  unsigned Size = 0;
+  for (BasicBlock *BB : L->blocks()) {
+    for (Instruction &I : *BB) {
+      if (isa<PHINode>(I) || isa<DbgInfoIntrinsic>(I)) {
+        continue;
+      }
+      ++Size;
+
+      LoadInst *LD = dyn_cast<LoadInst>(&I);
+      if (!LD || L->isLoopInvariant(LD->getPointerOperand())) {
+        continue;
+      }
+      if (util::InstrhasMetadata(LD, "Latency", "Long") && !Marked) {
+        Marked = true;
+        Loads.clear();
+      }
+      if (!Marked || util::InstrhasMetadata(LD, "Latency", "Long")) {
+        Loads.push_back(LD);
+      }
+    }
+  }
+
+  if (Loads.empty()) {
+    errs() << "No loads to overlap, not unrolling: " << L->getHeader()->getName() << "\n";
+    return 1;
+  }
+
+  // Loads at the same depth are independent of each other
+  map<Value *, unsigned> Depths;
+  set<Value *> InProgress;
+  map<unsigned, unsigned> Levels;
+  for (LoadInst *LD : Loads) {
+    ++Levels[getLoadDepth(L, LD, Depths, InProgress)];
+  }
+
+  unsigned MLP = 0;
+  for (auto &Level : Levels) {
+    MLP = max(MLP, Level.second);
+  }
+
+  unsigned Count = (MissCapacity + MLP - 1) / MLP;
+  Count = min(Count, UnrollSizeBudget / Size);
+  Count = min(Count, UnrollRegBudget / (unsigned)Loads.size());
+  Count = max(Count, 1u);
+
+  errs() << "Chose unroll count " << Count << " for " << L->getHeader()->getName()
+         << ": " << MLP << " of " << Loads.size() << " load(s) in flight per iteration, "
+         << Size << " instructions\n";
+  return Count;
+}
+
 bool ForcedLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
   if (L->getHeader()->getName().find(LoopName) == string::npos) {
     return false;
   }
 
-  if (UnrollCount <= 1) {
+  // A clairvoyance.unroll hint overrides -unroll for this loop
+  util::ClairvoyanceHints Hints;
+  util::getClairvoyanceHintsInNest(L, Hints);
+  unsigned Count = Hints.HasUnroll ? Hints.Unroll : (unsigned)UnrollCount;
+  bool Auto = Count == UnrollAuto;
+
+  // Outer loops are decoupled by whole inner loops, not unrolled
+  if ((Auto || Count > 1) && !L->empty()) {
+    errs() << "Not unrolling outer loop: " << L->getHeader()->getName() << "\n";
     return false;
   }
 
@@ -78,8 +200,26 @@ bool ForcedLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     return false;
   }
 
+  // Record the chosen count on the loop itself, without the hints of its
+  // parents
+  util::ClairvoyanceHints Own;
+  util::getClairvoyanceHints(L, Own);
+
+  if (Auto) {
+    Count = chooseUnrollCount(L);
+    if (Count <= 1) {
+      Own.Unroll = 1;
+      Own.HasUnroll = true;
+      util::setClairvoyanceHints(L, Own);
+      return true;
+    }
+  }
+
+  if (Count <= 1) {
+    return false;
+  }
+
   ScalarEvolution *SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
-  unsigned Count = UnrollCount;
   unsigned TripCount = 0;
   unsigned TripMultiple = 1;
 
@@ -99,6 +239,7 @@ bool ForcedLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
 
   assert(Count > 0);
   assert(TripMultiple > 0);
+  bool Complete = TripCount != 0 && Count == TripCount;
   assert(TripCount == 0 || TripCount % TripMultiple == 0);
 
   LoopInfo *LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
@@ -148,6 +289,13 @@ bool ForcedLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     }
   }
 
+  // A completely unrolled loop is gone, there is nothing to unroll later
+  if (Auto && UnrollSucceeded && !Complete) {
+    Own.Unroll = Count;
+    Own.HasUnroll = true;
+    util::setClairvoyanceHints(L, Own);
+  }
+
   return UnrollSucceeded;
 }
 
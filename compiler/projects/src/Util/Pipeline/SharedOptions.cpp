@@ -0,0 +1,41 @@
+//===------- SharedOptions.cpp - Options of several passes ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file SharedOptions.cpp
+///
+/// \brief
+///
+/// \copyright Eta Scale AB. Licensed under the Eta Scale Open Source License. See
+/// the LICENSE file for details.
+//
+//  Implementation of SharedOptions.h
+//===----------------------------------------------------------------------===//
+
+#include "Util/Pipeline/SharedOptions.h"
+
+cl::opt<std::string> BenchName("bench-name",
+                               cl::desc("The benchmark name"),
+                               cl::value_desc("name"));
+
+cl::opt<std::string> LoopName("loop-name",
+                              cl::desc("The keyword identifying the loop header to annotate or unroll"),
+                              cl::value_desc("name"));
+
+bool UnrollCountParser::parse(cl::Option &O, StringRef ArgName, StringRef Arg,
+                              unsigned &Value) {
+  if (Arg == "auto") {
+    Value = UnrollAuto;
+    return false;
+  }
+  return cl::parser<unsigned>::parse(O, ArgName, Arg, Value);
+}
+
+cl::opt<unsigned, false, UnrollCountParser> UnrollCount("unroll",
+                                                        cl::desc("Unroll count, or auto to choose it per loop"),
+                                                        cl::value_desc("unsigned|auto"),
+                                                        cl::init(1));
@@ -0,0 +1,142 @@
+#!/usr/bin/env python
+# Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+#
+# Runs every swoop variant in a bin directory next to $(BENCHMARK).original
+# on the same inputs and compares their output. A variant whose output or
+# exit status differs from the original on any input is reported as
+# DIVERGED; timings are reported only for variants that match on all inputs.
+# The exit status is 1 if any variant diverged, so the script can gate a
+# build.
+#
+# Each --input is one argument list. Pass the seed explicitly: the
+# benchmarks seed from time(NULL) when only a size is given.
+#
+# Example:
+#   scripts/diff_variants.py sources/sparseLinAlg/bin sparseLinAlg \
+#       --input "100000 1 random" --input "100000 1 powerlaw" \
+#       --match "checksum|check:"
+
+from __future__ import print_function, division
+
+import argparse
+import difflib
+import re
+import sys
+
+import variants
+
+
+def relevant_output(stdout, pattern):
+    """Lines of stdout that are compared, all of them if pattern is None.
+
+    Kernel times differ from run to run and are never compared."""
+    lines = [line for line in stdout.decode('utf-8', 'replace').splitlines()
+             if not variants.KERNEL_TIME.match(line)]
+    if pattern is None:
+        return lines
+    return [line for line in lines if pattern.search(line)]
+
+
+def first_difference(expected, actual):
+    """Short description of where actual first departs from expected."""
+    for line in difflib.unified_diff(expected, actual, 'original', 'variant',
+                                     lineterm='', n=0):
+        if line.startswith(('---', '+++', '@@')):
+            continue
+        return line
+    return ''
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Check swoop variants against the original binary.')
+    parser.add_argument('bindir', help='bin directory of the benchmark')
+    parser.add_argument('benchmark', help='$(BENCHMARK) name')
+    parser.add_argument('--input', action='append', default=[],
+                        help='arguments of one run, may be repeated '
+                        '(default: no arguments)')
+    parser.add_argument('--match',
+                        help='only compare output lines matching this '
+                        'regular expression, e.g. "checksum"')
+    parser.add_argument('--reps', type=int, default=3,
+                        help='timed runs per binary and input (default: 3)')
+    parser.add_argument('--timeout', type=float,
+                        help='seconds after which a run is killed and '
+                        'counted as diverged')
+    args = parser.parse_args()
+
+    if args.reps < 1:
+        parser.error('--reps has to be at least 1')
+    inputs = [i.split() for i in args.input] or [[]]
+    pattern = re.compile(args.match) if args.match else None
+
+    original, binaries = variants.find_variants(args.bindir, args.benchmark)
+
+    # Reference output and median runtime of the original per input
+    reference = []
+    for arguments in inputs:
+        times = []
+        for _ in range(args.reps):
+            seconds, code, stdout = variants.run(original, arguments,
+                                                 args.timeout)
+            if code is None:
+                print('original timed out on "%s"' % ' '.join(arguments),
+                      file=sys.stderr)
+                return 2
+            times.append(seconds)
+        reference.append((code, relevant_output(stdout, pattern),
+                          variants.median(times)))
+
+    diverged = []
+    correct = []
+    for binary in binaries:
+        name = variants.variant_name(binary, args.benchmark)
+        reason = None
+        speedups = []
+        for arguments, (code, expected, base) in zip(inputs, reference):
+            times = []
+            for _ in range(args.reps):
+                seconds, vcode, stdout = variants.run(binary, arguments,
+                                                      args.timeout)
+                if vcode is None:
+                    reason = 'timed out'
+                elif vcode != code:
+                    reason = 'exit status %d, original %d' % (vcode, code)
+                else:
+                    actual = relevant_output(stdout, pattern)
+                    if actual != expected:
+                        reason = 'output differs: ' + \
+                            first_difference(expected, actual)
+                if reason is not None:
+                    reason += ' on "%s"' % ' '.join(arguments)
+                    break
+                times.append(seconds)
+            if reason is not None:
+                break
+            t = variants.median(times)
+            speedups.append(base / t if t > 0 else float('inf'))
+        if reason is not None:
+            diverged.append((name, reason))
+        else:
+            correct.append((name, speedups))
+
+    # Inputs are columns so that the speedups of one variant read as a row
+    for i, arguments in enumerate(inputs):
+        print('in%d: %s (original %.4fs)' %
+              (i, ' '.join(arguments) or '<no arguments>', reference[i][2]))
+    print('%-32s %s' % ('variant', ' '.join('%10s' % ('in%d' % i)
+                                            for i in range(len(inputs)))))
+    for name, speedups in correct:
+        print('%-32s %s' % (name, ' '.join('%10.3f' % s for s in speedups)))
+    for name, reason in diverged:
+        print('%-32s DIVERGED: %s' % (name, reason))
+
+    if diverged:
+        print('%d of %d variants diverged from %s' %
+              (len(diverged), len(binaries), original), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+# Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+#
+# Writes the per source line profile read by -mark-loops -loop-profile (see
+# MarkLoopsToSwoopify/LoopProfile.h) from a perf recording of the original
+# binary, built with -g:
+#
+#   perf record -e cycles -e cache-misses -o perf.data bin/mcf.original ...
+#   scripts/loop_profile.py perf.data > bin/mcf.profile
+#   make LOOP_PROFILE=bin/mcf.profile
+#
+# Each line holds "file:line cycles misses", the share of the samples of the
+# two events at that source line.
+
+from __future__ import print_function, division
+
+import argparse
+import re
+import subprocess
+import sys
+
+SECTION = re.compile(r"^# Samples: .* of event '([^']+)'")
+ENTRY = re.compile(r'^\s*([0-9.]+)%\s+(\S+):([0-9]+)\s*$')
+
+
+def read_report(perf, data):
+    """Returns {event: {(file, line): share}} of perf report --sort srcline."""
+    output = subprocess.check_output(
+        [perf, 'report', '-i', data, '--stdio', '--no-children',
+         '--sort', 'srcline', '--percent-limit', '0'],
+        universal_newlines=True)
+
+    shares = {}
+    event = None
+    for text in output.splitlines():
+        section = SECTION.match(text)
+        if section:
+            event = shares.setdefault(section.group(1), {})
+            continue
+        entry = ENTRY.match(text)
+        if event is None or not entry or entry.group(3) == '0':
+            continue
+        key = (entry.group(2), int(entry.group(3)))
+        event[key] = event.get(key, 0.0) + float(entry.group(1)) / 100
+    return shares
+
+
+def find_event(shares, name):
+    """The samples of the event called name, with or without modifiers."""
+    for event, lines in shares.items():
+        if event == name or event.split(':')[0] == name:
+            return lines
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Convert a perf recording into a loop profile.')
+    parser.add_argument('data', help='perf.data of the original binary')
+    parser.add_argument('--cycles-event', default='cycles',
+                        help='event that samples time (default: cycles)')
+    parser.add_argument('--miss-event', default='cache-misses',
+                        help='event that samples the misses of loads '
+                        '(default: cache-misses)')
+    parser.add_argument('--perf', default='perf', help='perf executable')
+    args = parser.parse_args()
+
+    shares = read_report(args.perf, args.data)
+    cycles = find_event(shares, args.cycles_event)
+    misses = find_event(shares, args.miss_event)
+    if cycles is None or misses is None:
+        print('%s needs samples of %s and %s, found: %s' %
+              (args.data, args.cycles_event, args.miss_event,
+               ', '.join(sorted(shares)) or 'none'), file=sys.stderr)
+        return 1
+
+    print('# file:line cycles misses')
+    for key in sorted(set(cycles) | set(misses)):
+        print('%s:%d %.6f %.6f' % (key[0], key[1], cycles.get(key, 0.0),
+                                   misses.get(key, 0.0)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,204 @@
+#!/usr/bin/env python
+# Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+#
+# Runs $(BENCHMARK).original and every swoop variant in a bin directory over
+# a geometric sweep of input sizes, from well inside L1 to well beyond the
+# last level cache, and writes the median speedup of each variant per size.
+#
+# The benchmarks take the input size as their first argument and the seed as
+# their second (see myBenchmark/src/small_benchmark.cpp), so each size is run
+# as "<binary> <size> <seed> [extra args]".
+#
+# A run is timed by the kernel times the benchmark reports (see
+# sources/common/kernel_time.h), so that input generation and output do not
+# hide the kernels at small sizes. Benchmarks that report none are timed as
+# a whole.
+#
+# Example:
+#   scripts/size_sweep.py sources/myBenchmark/bin myBenchmark \
+#       --bytes-per-element 16 --reps 5
+
+from __future__ import print_function, division
+
+import argparse
+import glob
+import os
+import sys
+
+import variants
+
+CACHE_SYSFS = '/sys/devices/system/cpu/cpu0/cache'
+
+
+def parse_size(text):
+    """'48K' -> 49152"""
+    text = text.strip()
+    units = {'K': 1 << 10, 'M': 1 << 20, 'G': 1 << 30}
+    if text and text[-1].upper() in units:
+        return int(text[:-1]) * units[text[-1].upper()]
+    return int(text)
+
+
+def read_caches():
+    """Returns [(name, bytes)] of the data caches of cpu0, smallest first."""
+    caches = []
+    for index in glob.glob(os.path.join(CACHE_SYSFS, 'index*')):
+        try:
+            with open(os.path.join(index, 'type')) as f:
+                kind = f.read().strip()
+            with open(os.path.join(index, 'level')) as f:
+                level = f.read().strip()
+            with open(os.path.join(index, 'size')) as f:
+                size = parse_size(f.read())
+        except (IOError, ValueError):
+            continue
+        if kind == 'Instruction':
+            continue
+        caches.append(('L' + level, size))
+    return sorted(caches, key=lambda c: c[1])
+
+
+def memory_level(working_set, caches):
+    """Name of the smallest cache the working set fits in, or DRAM."""
+    for name, size in caches:
+        if working_set <= size:
+            return name
+    return 'DRAM'
+
+
+def geometric_sizes(first, last, factor):
+    sizes = []
+    size = first
+    while size <= last:
+        sizes.append(int(size))
+        size *= factor
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Speedup of swoop variants per input size.')
+    parser.add_argument('bindir', help='bin directory of the benchmark')
+    parser.add_argument('benchmark', help='$(BENCHMARK) name')
+    parser.add_argument('--bytes-per-element', type=int, required=True,
+                        help='bytes of working set per unit of the size '
+                        'argument, used to place sizes relative to the '
+                        'caches (SWEEP_BYTES_PER_ELEMENT of the benchmark)')
+    parser.add_argument('--min', type=int,
+                        help='smallest size argument (default: a quarter '
+                        'of L1)')
+    parser.add_argument('--max', type=int,
+                        help='largest size argument (default: eight times '
+                        'the last level cache)')
+    parser.add_argument('--factor', type=float, default=2.0,
+                        help='ratio between consecutive sizes (default: 2)')
+    parser.add_argument('--reps', type=int, default=5,
+                        help='runs per binary and size (default: 5)')
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('--extra-args', default='',
+                        help='arguments passed after size and seed')
+    parser.add_argument('--threshold', type=float, default=0.97,
+                        help='speedups below this are flagged as '
+                        'regressions (default: 0.97)')
+    parser.add_argument('--timeout', type=float,
+                        help='seconds after which a run is killed')
+    parser.add_argument('-o', '--output',
+                        help='table to write (default: '
+                        '<bindir>/<benchmark>.sweep.tsv)')
+    args = parser.parse_args()
+
+    if args.factor <= 1.0:
+        parser.error('--factor has to be larger than 1')
+    if args.reps < 1:
+        parser.error('--reps has to be at least 1')
+
+    caches = read_caches()
+    if caches:
+        first = caches[0][1] // 4 // args.bytes_per_element
+        last = caches[-1][1] * 8 // args.bytes_per_element
+    else:
+        print('warning: no cache information in ' + CACHE_SYSFS +
+              ', pass --min and --max', file=sys.stderr)
+        first, last = 1 << 8, 1 << 24
+    if args.min is not None:
+        first = args.min
+    if args.max is not None:
+        last = args.max
+    sizes = geometric_sizes(max(first, 1), last, args.factor)
+
+    original, binaries = variants.find_variants(args.bindir, args.benchmark)
+    names = [variants.variant_name(b, args.benchmark) for b in binaries]
+    if not binaries:
+        print('warning: only ' + original + ' found', file=sys.stderr)
+
+    output = args.output or os.path.join(args.bindir,
+                                         args.benchmark + '.sweep.tsv')
+    extra = args.extra_args.split()
+
+    # Median kernel time of binary at size, None if any run failed
+    untimed = set()
+
+    def measure(binary, size):
+        times = []
+        for _ in range(args.reps):
+            seconds, code, stdout = variants.run(
+                binary, [size, args.seed] + extra, args.timeout)
+            if code != 0:
+                return None
+            kernel = variants.kernel_seconds(stdout)
+            if kernel is None:
+                if binary not in untimed:
+                    untimed.add(binary)
+                    print('warning: ' + binary + ' reports no kernel time, '
+                          'timing the whole run', file=sys.stderr)
+                kernel = seconds
+            times.append(kernel)
+        return variants.median(times)
+
+    rows = []
+    regressions = []
+    for size in sizes:
+        level = memory_level(size * args.bytes_per_element, caches)
+        base = measure(original, size)
+        if base is None:
+            print('size %d: original failed, skipped' % size, file=sys.stderr)
+            continue
+        speedups = []
+        for binary, name in zip(binaries, names):
+            t = measure(binary, size)
+            if t is None or t == 0:
+                speedups.append(None)
+                continue
+            speedup = base / t
+            speedups.append(speedup)
+            if speedup < args.threshold:
+                regressions.append((size, level, name, speedup))
+        rows.append((size, level, base, speedups))
+        print('size %d (%s): original %.4fs' % (size, level, base),
+              file=sys.stderr)
+
+    # Regressions are marked with a trailing '!' so that they stand out in
+    # the table and are easy to grep for
+    with open(output, 'w') as out:
+        out.write('\t'.join(['size', 'level', 'original_s'] + names) + '\n')
+        for size, level, base, speedups in rows:
+            cells = [str(size), level, '%.6f' % base]
+            for speedup in speedups:
+                if speedup is None:
+                    cells.append('fail')
+                elif speedup < args.threshold:
+                    cells.append('%.3f!' % speedup)
+                else:
+                    cells.append('%.3f' % speedup)
+            out.write('\t'.join(cells) + '\n')
+    print('wrote ' + output)
+
+    if regressions:
+        print('regressions (speedup < %.2f):' % args.threshold)
+        for size, level, name, speedup in regressions:
+            print('  %-32s size %-10d %-5s %.3f' % (name, size, level, speedup))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,91 @@
+# Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+#
+# Helpers shared by the experiment scripts: locating the binaries that
+# Makefile.targets builds into a benchmark's bin directory and running them.
+
+from __future__ import print_function, division
+
+import os
+import re
+import subprocess
+import tempfile
+import time
+
+ORIGINAL_SUFFIX = 'original'
+
+# Files in bin/ that are build intermediates, not benchmark variants
+IGNORED_SUFFIXES = ('.ll', '.o', '.txt', '.tsv', '.csv')
+
+# Line a benchmark writes per timed kernel, see sources/common/kernel_time.h
+KERNEL_TIME = re.compile(r'^kernel-time: \S+ ([0-9.eE+-]+)\s*$')
+
+
+def find_variants(bindir, benchmark):
+    """Returns (original, variants) for the binaries of benchmark in bindir.
+
+    original is the path of $(BENCHMARK).original, variants a sorted list of
+    the paths of all other executables named $(BENCHMARK).<variant>.
+    """
+    original = os.path.join(bindir, benchmark + '.' + ORIGINAL_SUFFIX)
+    if not os.access(original, os.X_OK):
+        raise IOError('no executable ' + original + ', build the benchmark first')
+
+    variants = []
+    prefix = benchmark + '.'
+    for name in sorted(os.listdir(bindir)):
+        path = os.path.join(bindir, name)
+        if not name.startswith(prefix) or path == original:
+            continue
+        if name.endswith(IGNORED_SUFFIXES) or os.path.isdir(path):
+            continue
+        if os.access(path, os.X_OK):
+            variants.append(path)
+    return original, variants
+
+
+def variant_name(path, benchmark):
+    """unr2.indir1.consv for bin/$(BENCHMARK).unr2.indir1.consv"""
+    name = os.path.basename(path)
+    return name[len(benchmark) + 1:]
+
+
+def median(values):
+    ordered = sorted(values)
+    mid = len(ordered) // 2
+    if len(ordered) % 2 == 1:
+        return ordered[mid]
+    return (ordered[mid - 1] + ordered[mid]) / 2.0
+
+
+def kernel_seconds(stdout):
+    """Sum of the kernel times reported in stdout, None if there are none."""
+    times = []
+    for line in stdout.decode('utf-8', 'replace').splitlines():
+        match = KERNEL_TIME.match(line)
+        if match:
+            times.append(float(match.group(1)))
+    return sum(times) if times else None
+
+
+def run(binary, args, timeout=None):
+    """Runs binary with args and returns (seconds, returncode, stdout).
+
+    returncode is None if the run was killed after timeout seconds.
+    """
+    command = [binary] + [str(a) for a in args]
+
+    # Output goes to a temporary file rather than a pipe, so that the
+    # timeout can be implemented by polling (python2 has no
+    # communicate(timeout=...)) without the child blocking on a full pipe.
+    with tempfile.TemporaryFile() as sink:
+        start = time.time()
+        proc = subprocess.Popen(command, stdout=sink, stderr=subprocess.STDOUT)
+        while proc.poll() is None:
+            if timeout is not None and time.time() - start > timeout:
+                proc.kill()
+                proc.wait()
+                return time.time() - start, None, b''
+            time.sleep(0.001)
+        elapsed = time.time() - start
+        sink.seek(0)
+        return elapsed, proc.returncode, sink.read()
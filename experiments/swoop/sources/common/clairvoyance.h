@@ -0,0 +1,27 @@
+/** # Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+ *
+ * # Source level loop hints. CLAIRVOYANCE(...) in the body of a loop selects
+ * # the loop for the transformation: -mark-loops turns it into clairvoyance.*
+ * # loop metadata (see compiler/projects/include/Util/Annotation/LoopHints.h)
+ * # and removes it. Optional hints, separated by spaces:
+ * #
+ * #   unroll=N   unroll count, overrides -unroll
+ * #   indir=N    max number of indirections, overrides -indir-thresh
+ * #   type=T     swoop type the loop is tuned for, e.g. spec
+ * #   enable=0   deselects the loop instead
+ * #
+ * #   for (int i = 0; i < n; ++i) {
+ * #     CLAIRVOYANCE("unroll=2 indir=1");
+ * #     ...
+ * #   }
+ * #
+ * # The marker is an assembly comment that emits no instructions, but it
+ * # stays in builds that are not marked, such as the original binary, and
+ * # keeps the compiler from vectorizing the loop there. */
+
+#ifndef CLAIRVOYANCE_H
+#define CLAIRVOYANCE_H
+
+#define CLAIRVOYANCE(...) __asm__ __volatile__("# clairvoyance " __VA_ARGS__)
+
+#endif
@@ -0,0 +1,28 @@
+/** # Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+ *
+ * # Timing of the kernels of a benchmark, without input generation and
+ * # output. Each timed kernel writes a line to stderr:
+ * #
+ * #   kernel-time: <name> <seconds>
+ * #
+ * # scripts/size_sweep.py sums these per run, scripts/diff_variants.py does
+ * # not compare them. */
+
+#ifndef KERNEL_TIME_H
+#define KERNEL_TIME_H
+
+#include <stdio.h>
+#include <time.h>
+
+static inline double kernelClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Reports the time since start, a kernelClock() value, for kernel name */
+static inline void reportKernelTime(const char *name, double start) {
+  fprintf(stderr, "kernel-time: %s %.9f\n", name, kernelClock() - start);
+}
+
+#endif
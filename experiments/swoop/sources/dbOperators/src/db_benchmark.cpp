@@ -0,0 +1,414 @@
+/** # Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+ *
+ * # Database operator benchmark: hash join probe (chained and open
+ * # addressing), hash aggregation and B+-tree point lookups. Probe keys
+ * # follow a Zipf distribution, so the skew parameter moves the working set
+ * # between a few hot buckets and the whole table. */
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "../../common/kernel_time.h"
+
+using namespace std;
+
+static const int EMPTY_KEY = -1;
+static const int BTREE_FANOUT = 16;
+
+// Fraction of probe keys that do not exist in the build relation
+static const double MISS_RATIO = 0.1;
+
+static unsigned int hashKey(int key, unsigned int mask) {
+  return ((unsigned int)key * 2654435761u) & mask;
+}
+
+static unsigned int tableSizeFor(int numEntries) {
+  unsigned int size = 1;
+  while (size < 2u * numEntries) {
+    size <<= 1;
+  }
+  return size;
+}
+
+/** Tuple of the build relation R: unique key and a payload. */
+struct Tuple {
+  int key;
+  int payload;
+};
+
+/** Chained hash table: bucket heads index into the entry arrays,
+ * collisions are linked through next.
+ */
+struct ChainedTable {
+  unsigned int mask;
+  vector<int> head;
+  vector<int> next;
+  vector<Tuple> entries;
+};
+
+/** Open addressing hash table with linear probing. */
+struct OpenTable {
+  unsigned int mask;
+  vector<Tuple> slots;
+};
+
+/** Static B+-tree. Inner nodes route on keys[], children are indices into
+ * inner (if childIsLeaf is false) or into leaves.
+ */
+struct InnerNode {
+  int numKeys;
+  bool childIsLeaf;
+  int keys[BTREE_FANOUT - 1];
+  int child[BTREE_FANOUT];
+};
+
+struct LeafNode {
+  int numKeys;
+  int keys[BTREE_FANOUT];
+  int payload[BTREE_FANOUT];
+};
+
+struct BTree {
+  int root;
+  bool rootIsLeaf;
+  vector<InnerNode> inner;
+  vector<LeafNode> leaves;
+};
+
+/** Aggregation slot for the group-by. */
+struct Group {
+  int key;
+  int count;
+  long sum;
+};
+
+// Draws keys in [0, n) from a Zipf distribution with exponent skew
+// (skew = 0 is uniform). The rank is permuted so hot keys are scattered.
+class ZipfGenerator {
+public:
+  ZipfGenerator(int n, double skew) : cdf(n), perm(n) {
+    double total = 0.0;
+    for (int i = 0; i < n; ++i) {
+      total += 1.0 / pow((double)(i + 1), skew);
+      cdf[i] = total;
+    }
+    for (int i = 0; i < n; ++i) {
+      cdf[i] /= total;
+      perm[i] = i;
+    }
+    for (int i = n - 1; i > 0; --i) {
+      swap(perm[i], perm[rand() % (i + 1)]);
+    }
+  }
+
+  int next() {
+    double r = rand() / ((double)RAND_MAX + 1.0);
+    int rank = lower_bound(cdf.begin(), cdf.end(), r) - cdf.begin();
+    if (rank >= (int)cdf.size()) {
+      rank = cdf.size() - 1;
+    }
+    return perm[rank];
+  }
+
+private:
+  vector<double> cdf;
+  vector<int> perm;
+};
+
+// Build relation: numTuples unique keys with random payloads. Keys are the
+// even numbers, so odd numbers are guaranteed misses when probing.
+static void generateBuild(int numTuples, vector<Tuple> &R) {
+  R.resize(numTuples);
+  for (int i = 0; i < numTuples; ++i) {
+    R[i].key = 2 * i;
+    R[i].payload = rand() % 1000;
+  }
+  for (int i = numTuples - 1; i > 0; --i) {
+    swap(R[i], R[rand() % (i + 1)]);
+  }
+}
+
+// Probe relation: numKeys keys of R drawn with skew, MISS_RATIO of them
+// replaced by keys that are not in R.
+static void generateProbe(int numKeys, int buildSize, double skew, vector<int> &S) {
+  ZipfGenerator Zipf(buildSize, skew);
+  S.resize(numKeys);
+  for (int i = 0; i < numKeys; ++i) {
+    int key = 2 * Zipf.next();
+    if (rand() / ((double)RAND_MAX + 1.0) < MISS_RATIO) {
+      key += 1;
+    }
+    S[i] = key;
+  }
+}
+
+static void buildChained(const vector<Tuple> &R, ChainedTable &T) {
+  T.mask = tableSizeFor(R.size()) / 2 - 1;
+  T.head.assign(T.mask + 1, -1);
+  T.next.resize(R.size());
+  T.entries = R;
+  for (int i = 0; i < (int)R.size(); ++i) {
+    unsigned int h = hashKey(R[i].key, T.mask);
+    T.next[i] = T.head[h];
+    T.head[h] = i;
+  }
+}
+
+static void buildOpen(const vector<Tuple> &R, OpenTable &T) {
+  T.mask = tableSizeFor(R.size()) - 1;
+  Tuple Empty = {EMPTY_KEY, 0};
+  T.slots.assign(T.mask + 1, Empty);
+  for (int i = 0; i < (int)R.size(); ++i) {
+    unsigned int h = hashKey(R[i].key, T.mask);
+    while (T.slots[h].key != EMPTY_KEY) {
+      h = (h + 1) & T.mask;
+    }
+    T.slots[h] = R[i];
+  }
+}
+
+static bool keyLess(const Tuple &A, const Tuple &B) {
+  return A.key < B.key;
+}
+
+// Bulk loads a B+-tree from R (sorted by key first).
+static void buildBTree(vector<Tuple> R, BTree &T) {
+  sort(R.begin(), R.end(), keyLess);
+
+  // Fill leaves, remember the smallest key of every node for routing
+  vector<int> level, levelMin;
+  for (size_t i = 0; i < R.size(); i += BTREE_FANOUT) {
+    LeafNode Leaf;
+    Leaf.numKeys = min((size_t)BTREE_FANOUT, R.size() - i);
+    for (int k = 0; k < Leaf.numKeys; ++k) {
+      Leaf.keys[k] = R[i + k].key;
+      Leaf.payload[k] = R[i + k].payload;
+    }
+    level.push_back(T.leaves.size());
+    levelMin.push_back(Leaf.keys[0]);
+    T.leaves.push_back(Leaf);
+  }
+
+  bool childIsLeaf = true;
+  while (level.size() > 1) {
+    vector<int> upper, upperMin;
+    for (size_t i = 0; i < level.size(); i += BTREE_FANOUT) {
+      InnerNode Node;
+      int numChildren = min((size_t)BTREE_FANOUT, level.size() - i);
+      Node.numKeys = numChildren - 1;
+      Node.childIsLeaf = childIsLeaf;
+      for (int c = 0; c < numChildren; ++c) {
+        Node.child[c] = level[i + c];
+        if (c > 0) {
+          Node.keys[c - 1] = levelMin[i + c];
+        }
+      }
+      upper.push_back(T.inner.size());
+      upperMin.push_back(levelMin[i]);
+      T.inner.push_back(Node);
+    }
+    level.swap(upper);
+    levelMin.swap(upperMin);
+    childIsLeaf = false;
+  }
+
+  T.root = level[0];
+  T.rootIsLeaf = childIsLeaf;
+}
+
+// Probes the chained table for every key in S; sums up matching payloads.
+long probeChained(const ChainedTable &T, const vector<int> &S, long &matches) {
+  const int *head = &T.head[0];
+  const int *next = &T.next[0];
+  const Tuple *entries = &T.entries[0];
+  unsigned int mask = T.mask;
+  int n = S.size();
+  long sum = 0, found = 0;
+
+#pragma clang loop vectorize_width(1337)
+  for (int i = 0; i < n; ++i) {
+    int key = S[i];
+    for (int e = head[hashKey(key, mask)]; e != -1; e = next[e]) {
+      if (entries[e].key == key) {
+        sum += entries[e].payload;
+        ++found;
+      }
+    }
+  }
+
+  matches = found;
+  return sum;
+}
+
+// Probes the open addressing table for every key in S; stops at the first
+// match or at an empty slot.
+long probeOpen(const OpenTable &T, const vector<int> &S, long &matches) {
+  const Tuple *slots = &T.slots[0];
+  unsigned int mask = T.mask;
+  int n = S.size();
+  long sum = 0, found = 0;
+
+#pragma clang loop vectorize_width(1337)
+  for (int i = 0; i < n; ++i) {
+    int key = S[i];
+    unsigned int h = hashKey(key, mask);
+    while (slots[h].key != EMPTY_KEY) {
+      if (slots[h].key == key) {
+        sum += slots[h].payload;
+        ++found;
+        break;
+      }
+      h = (h + 1) & mask;
+    }
+  }
+
+  matches = found;
+  return sum;
+}
+
+// Group-by key with count and sum(value) into an open addressing table.
+// Returns the number of groups.
+int hashAggregate(const vector<int> &keys, const vector<int> &values,
+                  vector<Group> &groups) {
+  unsigned int mask = tableSizeFor(keys.size()) - 1;
+  Group Empty = {EMPTY_KEY, 0, 0};
+  groups.assign(mask + 1, Empty);
+  Group *table = &groups[0];
+  int n = keys.size();
+  int numGroups = 0;
+
+#pragma clang loop vectorize_width(1337)
+  for (int i = 0; i < n; ++i) {
+    int key = keys[i];
+    unsigned int h = hashKey(key, mask);
+    while (table[h].key != key && table[h].key != EMPTY_KEY) {
+      h = (h + 1) & mask;
+    }
+    if (table[h].key == EMPTY_KEY) {
+      table[h].key = key;
+      ++numGroups;
+    }
+    table[h].count++;
+    table[h].sum += values[i];
+  }
+
+  return numGroups;
+}
+
+// Point lookups of every key in S in the B+-tree.
+long lookupBTree(const BTree &T, const vector<int> &S, long &matches) {
+  const InnerNode *inner = T.inner.empty() ? NULL : &T.inner[0];
+  const LeafNode *leaves = &T.leaves[0];
+  int n = S.size();
+  long sum = 0, found = 0;
+
+#pragma clang loop vectorize_width(1337)
+  for (int i = 0; i < n; ++i) {
+    int key = S[i];
+    int node = T.root;
+    bool isLeaf = T.rootIsLeaf;
+    while (!isLeaf) {
+      const InnerNode *Node = &inner[node];
+      int c = 0;
+      while (c < Node->numKeys && key >= Node->keys[c]) {
+        ++c;
+      }
+      isLeaf = Node->childIsLeaf;
+      node = Node->child[c];
+    }
+
+    const LeafNode *Leaf = &leaves[node];
+    for (int k = 0; k < Leaf->numKeys; ++k) {
+      if (Leaf->keys[k] == key) {
+        sum += Leaf->payload[k];
+        ++found;
+        break;
+      }
+    }
+  }
+
+  matches = found;
+  return sum;
+}
+
+int main(int argc, char* argv[]) {
+  int numRows, seed;
+  double skew = 0.0;
+
+  // Arguments: [numRows [seed [skew]]]
+  if (argc == 1) {
+    numRows = 1 << 20;
+    seed = 0;
+  } else if (argc == 2) {
+    numRows = atoi(argv[1]);
+    seed = time(NULL);
+    cout << "default random with time..." << endl;
+  } else {
+    numRows = atoi(argv[1]);
+    seed = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    skew = atof(argv[3]);
+  }
+  if (numRows < 4) {
+    cerr << "numRows has to be at least 4" << endl;
+    return 1;
+  }
+  srand(seed);
+
+  // The build side is a quarter of the probe side, as for a typical
+  // dimension/fact join
+  int buildSize = numRows / 4;
+  vector<Tuple> R;
+  vector<int> S;
+  generateBuild(buildSize, R);
+  generateProbe(numRows, buildSize, skew, S);
+
+  cout << "tables: build=" << buildSize << " probe=" << numRows
+       << " skew=" << skew << endl;
+
+  ChainedTable Chained;
+  buildChained(R, Chained);
+  long matches;
+  double start = kernelClock();
+  long sum = probeChained(Chained, S, matches);
+  reportKernelTime("join-chained", start);
+  cout << "join-chained: matches=" << matches << " checksum=" << sum << endl;
+
+  OpenTable Open;
+  buildOpen(R, Open);
+  start = kernelClock();
+  sum = probeOpen(Open, S, matches);
+  reportKernelTime("join-open", start);
+  cout << "join-open: matches=" << matches << " checksum=" << sum << endl;
+
+  vector<int> values(numRows);
+  for (int i = 0; i < numRows; ++i) {
+    values[i] = rand() % 100;
+  }
+  vector<Group> groups;
+  start = kernelClock();
+  int numGroups = hashAggregate(S, values, groups);
+  reportKernelTime("groupby", start);
+  long groupChecksum = 0;
+  for (size_t g = 0; g < groups.size(); ++g) {
+    if (groups[g].key != EMPTY_KEY) {
+      groupChecksum += (long)groups[g].key * groups[g].count + groups[g].sum;
+    }
+  }
+  cout << "groupby: groups=" << numGroups << " checksum=" << groupChecksum << endl;
+
+  BTree Tree;
+  buildBTree(R, Tree);
+  start = kernelClock();
+  sum = lookupBTree(Tree, S, matches);
+  reportKernelTime("btree", start);
+  cout << "btree: matches=" << matches << " checksum=" << sum << endl;
+
+  return 0;
+}
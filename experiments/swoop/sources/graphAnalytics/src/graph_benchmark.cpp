@@ -0,0 +1,305 @@
+/** # Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+ *
+ * # Graph analytics benchmark: BFS, PageRank and connected components on a
+ * # CSR graph. The neighbour loops index node arrays through the edge array
+ * # (dist[col[e]], rank[col[e]], comp[col[e]]), the irregular accesses that
+ * # the access phase is meant to prefetch. */
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+#include "../../common/kernel_time.h"
+
+using namespace std;
+
+/** Graph in compressed sparse row format.
+ * rowStart has numVertices+1 entries, the neighbours of vertex v are
+ * col[rowStart[v]] .. col[rowStart[v+1]-1].
+ */
+struct CSRGraph {
+  int numVertices;
+  vector<int> rowStart;
+  vector<int> col;
+};
+
+static const int AVG_DEGREE = 8;
+static const int PAGERANK_ITERATIONS = 10;
+static const double DAMPING = 0.85;
+
+static double randUnit() {
+  return rand() / ((double)RAND_MAX + 1.0);
+}
+
+// Uniform random graph: every edge connects two vertices picked uniformly.
+static void generateUniform(int numVertices, vector<pair<int, int> > &edges) {
+  long numEdges = (long)numVertices * AVG_DEGREE / 2;
+  for (long e = 0; e < numEdges; ++e) {
+    int src = rand() % numVertices;
+    int dst = rand() % numVertices;
+    edges.push_back(make_pair(src, dst));
+  }
+}
+
+// R-MAT graph (Chakrabarti et al.) with the Graph500 probabilities. Yields a
+// power-law degree distribution, i.e. a few hubs and many small rows.
+static void generateRMAT(int numVertices, vector<pair<int, int> > &edges) {
+  const double A = 0.57, B = 0.19, C = 0.19;
+  int scale = 0;
+  while ((1 << scale) < numVertices) {
+    ++scale;
+  }
+
+  long numEdges = (long)numVertices * AVG_DEGREE / 2;
+  for (long e = 0; e < numEdges; ++e) {
+    int src = 0, dst = 0;
+    for (int bit = scale - 1; bit >= 0; --bit) {
+      double r = randUnit();
+      if (r < A) {
+        // top left quadrant
+      } else if (r < A + B) {
+        dst |= 1 << bit;
+      } else if (r < A + B + C) {
+        src |= 1 << bit;
+      } else {
+        src |= 1 << bit;
+        dst |= 1 << bit;
+      }
+    }
+    // Fold ids outside of the range back, numVertices need not be a power of two
+    edges.push_back(make_pair(src % numVertices, dst % numVertices));
+  }
+
+  // Permute vertex ids, otherwise the hubs are all clustered at low ids
+  vector<int> perm(numVertices);
+  for (int i = 0; i < numVertices; ++i) {
+    perm[i] = i;
+  }
+  for (int i = numVertices - 1; i > 0; --i) {
+    swap(perm[i], perm[rand() % (i + 1)]);
+  }
+  for (size_t e = 0; e < edges.size(); ++e) {
+    edges[e].first = perm[edges[e].first];
+    edges[e].second = perm[edges[e].second];
+  }
+}
+
+// Builds an undirected CSR graph (both directions of every edge, no self loops).
+static void buildCSR(int numVertices, vector<pair<int, int> > &edges, CSRGraph &G) {
+  G.numVertices = numVertices;
+  G.rowStart.assign(numVertices + 1, 0);
+
+  for (size_t e = 0; e < edges.size(); ++e) {
+    if (edges[e].first == edges[e].second) {
+      continue;
+    }
+    G.rowStart[edges[e].first + 1]++;
+    G.rowStart[edges[e].second + 1]++;
+  }
+  for (int v = 0; v < numVertices; ++v) {
+    G.rowStart[v + 1] += G.rowStart[v];
+  }
+
+  G.col.resize(G.rowStart[numVertices]);
+  vector<int> fill(G.rowStart.begin(), G.rowStart.end() - 1);
+  for (size_t e = 0; e < edges.size(); ++e) {
+    int src = edges[e].first, dst = edges[e].second;
+    if (src == dst) {
+      continue;
+    }
+    G.col[fill[src]++] = dst;
+    G.col[fill[dst]++] = src;
+  }
+}
+
+// Level-synchronous top-down BFS. Returns the number of reached vertices,
+// dist holds the level of every vertex (-1 if unreached).
+int bfs(const CSRGraph &G, int source, vector<int> &dist) {
+  const int *rowStart = &G.rowStart[0];
+  const int *col = &G.col[0];
+  dist.assign(G.numVertices, -1);
+  vector<int> frontier, next;
+  frontier.reserve(G.numVertices);
+  next.resize(G.numVertices);
+
+  dist[source] = 0;
+  frontier.push_back(source);
+  int reached = 1;
+  int level = 0;
+  int *d = &dist[0];
+
+  while (!frontier.empty()) {
+    int nextSize = 0;
+    int *nextFrontier = &next[0];
+    int frontierSize = frontier.size();
+#pragma clang loop vectorize_width(1337)
+    for (int i = 0; i < frontierSize; ++i) {
+      int u = frontier[i];
+      for (int e = rowStart[u]; e < rowStart[u + 1]; ++e) {
+        int v = col[e];
+        if (d[v] < 0) {
+          d[v] = level + 1;
+          nextFrontier[nextSize++] = v;
+        }
+      }
+    }
+    reached += nextSize;
+    frontier.assign(next.begin(), next.begin() + nextSize);
+    ++level;
+  }
+
+  return reached;
+}
+
+// Pull-based PageRank: every vertex gathers the contributions of its
+// neighbours, contrib[col[e]] is the indirect load.
+void pageRank(const CSRGraph &G, vector<double> &rank) {
+  const int *rowStart = &G.rowStart[0];
+  const int *col = &G.col[0];
+  int n = G.numVertices;
+  rank.assign(n, 1.0 / n);
+  vector<double> contrib(n);
+  double *c = &contrib[0];
+  double *r = &rank[0];
+  double base = (1.0 - DAMPING) / n;
+
+  for (int it = 0; it < PAGERANK_ITERATIONS; ++it) {
+    for (int v = 0; v < n; ++v) {
+      int degree = rowStart[v + 1] - rowStart[v];
+      c[v] = degree > 0 ? r[v] / degree : 0.0;
+    }
+
+#pragma clang loop vectorize_width(1337)
+    for (int v = 0; v < n; ++v) {
+      double sum = 0.0;
+      for (int e = rowStart[v]; e < rowStart[v + 1]; ++e) {
+        sum += c[col[e]];
+      }
+      r[v] = base + DAMPING * sum;
+    }
+  }
+}
+
+// Connected components by min-label propagation. Returns the number of
+// sweeps until convergence.
+int connectedComponents(const CSRGraph &G, vector<int> &comp) {
+  const int *rowStart = &G.rowStart[0];
+  const int *col = &G.col[0];
+  int n = G.numVertices;
+  comp.resize(n);
+  for (int v = 0; v < n; ++v) {
+    comp[v] = v;
+  }
+  int *label = &comp[0];
+
+  int sweeps = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+#pragma clang loop vectorize_width(1337)
+    for (int v = 0; v < n; ++v) {
+      int best = label[v];
+      for (int e = rowStart[v]; e < rowStart[v + 1]; ++e) {
+        int l = label[col[e]];
+        if (l < best) {
+          best = l;
+        }
+      }
+      if (best < label[v]) {
+        label[v] = best;
+        changed = true;
+      }
+    }
+    ++sweeps;
+  }
+
+  return sweeps;
+}
+
+int main(int argc, char* argv[]) {
+  int numVertices, seed;
+  bool useRMAT = true;
+
+  // Arguments: [numVertices [seed [rmat|uniform]]]
+  if (argc == 1) {
+    numVertices = 1 << 20;
+    seed = 0;
+  } else if (argc == 2) {
+    numVertices = atoi(argv[1]);
+    seed = time(NULL);
+    cout << "default random with time..." << endl;
+  } else {
+    numVertices = atoi(argv[1]);
+    seed = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    useRMAT = strcmp(argv[3], "uniform") != 0;
+  }
+  if (numVertices < 2) {
+    cerr << "numVertices has to be at least 2" << endl;
+    return 1;
+  }
+  srand(seed);
+
+  vector<pair<int, int> > edges;
+  if (useRMAT) {
+    generateRMAT(numVertices, edges);
+  } else {
+    generateUniform(numVertices, edges);
+  }
+
+  CSRGraph G;
+  buildCSR(numVertices, edges, G);
+  edges.clear();
+
+  cout << "graph: " << (useRMAT ? "rmat" : "uniform") << " vertices="
+       << G.numVertices << " edges=" << G.col.size() << endl;
+
+  // BFS from the highest-degree vertex, so that the frontier reaches the
+  // giant component
+  int source = 0;
+  for (int v = 1; v < numVertices; ++v) {
+    if (G.rowStart[v + 1] - G.rowStart[v] > G.rowStart[source + 1] - G.rowStart[source]) {
+      source = v;
+    }
+  }
+  vector<int> dist;
+  double start = kernelClock();
+  int reached = bfs(G, source, dist);
+  reportKernelTime("bfs", start);
+  long distSum = 0;
+  for (int v = 0; v < numVertices; ++v) {
+    distSum += dist[v] >= 0 ? dist[v] : 0;
+  }
+  cout << "bfs: reached=" << reached << " checksum=" << distSum << endl;
+
+  vector<double> rank;
+  start = kernelClock();
+  pageRank(G, rank);
+  reportKernelTime("pagerank", start);
+  double rankSum = 0.0, rankMax = 0.0;
+  for (int v = 0; v < numVertices; ++v) {
+    rankSum += rank[v];
+    rankMax = max(rankMax, rank[v]);
+  }
+  cout << "pagerank: checksum=" << setprecision(10) << rankSum
+       << " max=" << rankMax << endl;
+
+  vector<int> comp;
+  start = kernelClock();
+  int sweeps = connectedComponents(G, comp);
+  reportKernelTime("cc", start);
+  long components = 0, labelSum = 0;
+  for (int v = 0; v < numVertices; ++v) {
+    components += comp[v] == v;
+    labelSum += comp[v];
+  }
+  cout << "cc: components=" << components << " sweeps=" << sweeps
+       << " checksum=" << labelSum << endl;
+
+  return 0;
+}
@@ -6,6 +6,8 @@
 #include <iostream>
 #include <vector>
 
+#include "../../common/kernel_time.h"
+
 using namespace std;
 
 /** Person struct holds 3 attributes which all null initialized: ID, attr, contactPerson.
@@ -62,6 +64,7 @@ int main(int argc, char* argv[]){
   }
   //Person's attr is changed to 1 if the contactPerson of this Person's contactPerson is this Person oneself.
   //loop with 5 indirections
+  double start = kernelClock();
 #pragma clang loop vectorize_width(1337)
   for(int i = 0; i < vecSize; ++i){
     if ((record[(record[i].contactPerson->ID)-1].contactPerson->ID)-1 == i){
@@ -69,6 +72,7 @@ int main(int argc, char* argv[]){
       record[(record[i].contactPerson->ID)-1].attr = 1;
     }
   }
+  reportKernelTime("contacts", start);
 
   //print information on all Person in vector
   for(int i = 0; i < vecSize; i++){
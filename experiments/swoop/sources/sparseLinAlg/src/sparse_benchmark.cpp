@@ -0,0 +1,307 @@
+/** # Copyright (C) Eta Scale AB. Licensed under the Eta Scale Open Source License. See the LICENSE file for details.
+ *
+ * # Sparse linear algebra benchmark: CSR and COO SpMV, sparse times dense
+ * # matrix (SpMM) and an indexed gather/scatter. All kernels read x[col[j]],
+ * # the indirect load the access phase targets. Results are checked against
+ * # a reference computed from the unsorted triplets. */
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+#include "../../common/kernel_time.h"
+
+using namespace std;
+
+static const int NNZ_PER_ROW = 8;
+static const int BAND_WIDTH = 16;
+static const int DENSE_COLUMNS = 4;
+static const double TOLERANCE = 1e-9;
+
+enum MatrixKind { BANDED, POWERLAW, RANDOM };
+
+/** Matrix entry in coordinate format. */
+struct Triplet {
+  int row;
+  int col;
+  double val;
+};
+
+/** Matrix in compressed sparse row format. */
+struct CSRMatrix {
+  int n;
+  vector<int> rowStart;
+  vector<int> col;
+  vector<double> val;
+};
+
+/** Matrix in coordinate format, sorted by row. */
+struct COOMatrix {
+  int n;
+  vector<int> row;
+  vector<int> col;
+  vector<double> val;
+};
+
+static double randUnit() {
+  return rand() / ((double)RAND_MAX + 1.0);
+}
+
+// Banded matrix: nonzeros within BAND_WIDTH of the diagonal, so x[col[j]]
+// walks almost sequentially.
+static void generateBanded(int n, vector<Triplet> &T) {
+  for (int r = 0; r < n; ++r) {
+    for (int k = 0; k < NNZ_PER_ROW; ++k) {
+      int c = r + (rand() % (2 * BAND_WIDTH + 1)) - BAND_WIDTH;
+      c = min(max(c, 0), n - 1);
+      Triplet E = {r, c, randUnit()};
+      T.push_back(E);
+    }
+  }
+}
+
+// Power-law matrix: row lengths and column popularity both follow a
+// heavy-tailed distribution (few long rows, few hot columns).
+static void generatePowerLaw(int n, vector<Triplet> &T) {
+  long total = (long)n * NNZ_PER_ROW;
+  for (long k = 0; k < total; ++k) {
+    // n * u^a has a power-law density that concentrates near index 0
+    int r = (int)(n * pow(randUnit(), 2.0)) % n;
+    int c = (int)(n * pow(randUnit(), 3.0)) % n;
+    // Scatter the hot rows and columns over the index space
+    r = (int)(((unsigned long)r * 2654435761u) % n);
+    c = (int)(((unsigned long)c * 40503u + 7) % n);
+    Triplet E = {r, c, randUnit()};
+    T.push_back(E);
+  }
+}
+
+// Random matrix: NNZ_PER_ROW uniformly distributed columns per row.
+static void generateRandom(int n, vector<Triplet> &T) {
+  for (int r = 0; r < n; ++r) {
+    for (int k = 0; k < NNZ_PER_ROW; ++k) {
+      Triplet E = {r, rand() % n, randUnit()};
+      T.push_back(E);
+    }
+  }
+}
+
+static bool rowLess(const Triplet &A, const Triplet &B) {
+  return A.row < B.row || (A.row == B.row && A.col < B.col);
+}
+
+static void buildMatrices(int n, vector<Triplet> T, CSRMatrix &CSR, COOMatrix &COO) {
+  sort(T.begin(), T.end(), rowLess);
+
+  CSR.n = n;
+  CSR.rowStart.assign(n + 1, 0);
+  CSR.col.resize(T.size());
+  CSR.val.resize(T.size());
+  COO.n = n;
+  COO.row.resize(T.size());
+  COO.col.resize(T.size());
+  COO.val.resize(T.size());
+
+  for (size_t k = 0; k < T.size(); ++k) {
+    CSR.rowStart[T[k].row + 1]++;
+    CSR.col[k] = COO.col[k] = T[k].col;
+    CSR.val[k] = COO.val[k] = T[k].val;
+    COO.row[k] = T[k].row;
+  }
+  for (int r = 0; r < n; ++r) {
+    CSR.rowStart[r + 1] += CSR.rowStart[r];
+  }
+}
+
+// y = A * x, A in CSR
+void spmvCSR(const CSRMatrix &A, const double *x, double *y) {
+  const int *rowStart = &A.rowStart[0];
+  const int *col = &A.col[0];
+  const double *val = &A.val[0];
+  int n = A.n;
+
+#pragma clang loop vectorize_width(1337)
+  for (int r = 0; r < n; ++r) {
+    double sum = 0.0;
+    for (int j = rowStart[r]; j < rowStart[r + 1]; ++j) {
+      sum += val[j] * x[col[j]];
+    }
+    y[r] = sum;
+  }
+}
+
+// y = A * x, A in COO
+void spmvCOO(const COOMatrix &A, const double *x, double *y) {
+  const int *row = &A.row[0];
+  const int *col = &A.col[0];
+  const double *val = &A.val[0];
+  int nnz = A.val.size();
+
+  memset(y, 0, A.n * sizeof(double));
+#pragma clang loop vectorize_width(1337)
+  for (int j = 0; j < nnz; ++j) {
+    y[row[j]] += val[j] * x[col[j]];
+  }
+}
+
+// Y = A * X with X and Y dense, row-major with k columns. The dense column
+// loop is outside the row's nonzeros, so that the innermost loop, the one
+// that is marked, is the j loop with the indirect access X[col[j]].
+void spmm(const CSRMatrix &A, const double *X, double *Y, int k) {
+  const int *rowStart = &A.rowStart[0];
+  const int *col = &A.col[0];
+  const double *val = &A.val[0];
+  int n = A.n;
+
+#pragma clang loop vectorize_width(1337)
+  for (int r = 0; r < n; ++r) {
+    double *y = Y + (long)r * k;
+    for (int c = 0; c < k; ++c) {
+      double sum = 0.0;
+      for (int j = rowStart[r]; j < rowStart[r + 1]; ++j) {
+        sum += val[j] * X[(long)col[j] * k + c];
+      }
+      y[c] = sum;
+    }
+  }
+}
+
+// dst[scatterIdx[i]] += src[gatherIdx[i]]
+void gatherScatter(const int *gatherIdx, const int *scatterIdx, const double *src,
+                   double *dst, int m) {
+#pragma clang loop vectorize_width(1337)
+  for (int i = 0; i < m; ++i) {
+    dst[scatterIdx[i]] += src[gatherIdx[i]];
+  }
+}
+
+static bool closeEnough(const double *A, const double *B, long n) {
+  for (long i = 0; i < n; ++i) {
+    if (fabs(A[i] - B[i]) > TOLERANCE * (1.0 + fabs(B[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static double sum(const double *A, long n) {
+  double s = 0.0;
+  for (long i = 0; i < n; ++i) {
+    s += A[i];
+  }
+  return s;
+}
+
+int main(int argc, char* argv[]) {
+  int n, seed;
+  MatrixKind kind = RANDOM;
+
+  // Arguments: [rows [seed [banded|powerlaw|random]]]
+  if (argc == 1) {
+    n = 1 << 20;
+    seed = 0;
+  } else if (argc == 2) {
+    n = atoi(argv[1]);
+    seed = time(NULL);
+    cout << "default random with time..." << endl;
+  } else {
+    n = atoi(argv[1]);
+    seed = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    if (strcmp(argv[3], "banded") == 0) {
+      kind = BANDED;
+    } else if (strcmp(argv[3], "powerlaw") == 0) {
+      kind = POWERLAW;
+    }
+  }
+  if (n < 1) {
+    cerr << "rows has to be at least 1" << endl;
+    return 1;
+  }
+  srand(seed);
+
+  vector<Triplet> T;
+  const char *kindName;
+  switch (kind) {
+  case BANDED:
+    generateBanded(n, T);
+    kindName = "banded";
+    break;
+  case POWERLAW:
+    generatePowerLaw(n, T);
+    kindName = "powerlaw";
+    break;
+  default:
+    generateRandom(n, T);
+    kindName = "random";
+    break;
+  }
+
+  CSRMatrix CSR;
+  COOMatrix COO;
+  buildMatrices(n, T, CSR, COO);
+  cout << "matrix: " << kindName << " rows=" << n << " nnz=" << T.size() << endl;
+
+  vector<double> x(n), Xd((long)n * DENSE_COLUMNS);
+  for (int i = 0; i < n; ++i) {
+    x[i] = randUnit();
+  }
+  for (long i = 0; i < (long)n * DENSE_COLUMNS; ++i) {
+    Xd[i] = randUnit();
+  }
+
+  // Reference results from the triplets in generation order
+  vector<double> yRef(n, 0.0), YRef((long)n * DENSE_COLUMNS, 0.0);
+  for (size_t k = 0; k < T.size(); ++k) {
+    yRef[T[k].row] += T[k].val * x[T[k].col];
+    for (int c = 0; c < DENSE_COLUMNS; ++c) {
+      YRef[(long)T[k].row * DENSE_COLUMNS + c] +=
+          T[k].val * Xd[(long)T[k].col * DENSE_COLUMNS + c];
+    }
+  }
+
+  bool ok = true;
+  cout << setprecision(10);
+
+  vector<double> y(n);
+  double start = kernelClock();
+  spmvCSR(CSR, &x[0], &y[0]);
+  reportKernelTime("spmv-csr", start);
+  ok &= closeEnough(&y[0], &yRef[0], n);
+  cout << "spmv-csr: checksum=" << sum(&y[0], n) << endl;
+
+  start = kernelClock();
+  spmvCOO(COO, &x[0], &y[0]);
+  reportKernelTime("spmv-coo", start);
+  ok &= closeEnough(&y[0], &yRef[0], n);
+  cout << "spmv-coo: checksum=" << sum(&y[0], n) << endl;
+
+  vector<double> Y((long)n * DENSE_COLUMNS);
+  start = kernelClock();
+  spmm(CSR, &Xd[0], &Y[0], DENSE_COLUMNS);
+  reportKernelTime("spmm", start);
+  ok &= closeEnough(&Y[0], &YRef[0], (long)n * DENSE_COLUMNS);
+  cout << "spmm: checksum=" << sum(&Y[0], (long)n * DENSE_COLUMNS) << endl;
+
+  // Gather along the column indices, scatter along the row indices: the
+  // same indirection pattern as the transposed SpMV
+  int nnz = T.size();
+  vector<double> dst(n, 0.0), dstRef(n, 0.0);
+  start = kernelClock();
+  gatherScatter(&COO.col[0], &COO.row[0], &x[0], &dst[0], nnz);
+  reportKernelTime("gather-scatter", start);
+  for (int i = 0; i < nnz; ++i) {
+    dstRef[COO.row[i]] += x[COO.col[i]];
+  }
+  ok &= closeEnough(&dst[0], &dstRef[0], n);
+  cout << "gather-scatter: checksum=" << sum(&dst[0], n) << endl;
+
+  cout << "check: " << (ok ? "ok" : "FAILED") << endl;
+  return ok ? 0 : 1;
+}